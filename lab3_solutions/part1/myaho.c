@@ -0,0 +1,222 @@
+/*
+ * myaho.c
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+
+#include "myaho.h"
+
+void freeAhoCorasick(struct AhoCorasick *ac)
+{
+    free(ac->next);
+    free(ac->match);
+    free(ac->dict);
+    free(ac->same);
+    memset(ac, 0, sizeof(*ac));
+}
+
+// Add a state with no children and no pattern to the trie.
+static int32_t newState(struct AhoCorasick *ac)
+{
+    int32_t t = ac->nstates++;
+
+    for (int c = 0; c < ac->nclasses; c++)
+        ac->next[t * ac->nclasses + c] = -1;
+    ac->match[t] = -1;
+    ac->dict[t] = -1;
+    return t;
+}
+
+int buildAhoCorasick(struct AhoCorasick *ac, const char *const *patterns,
+    int npatterns)
+{
+    memset(ac, 0, sizeof(*ac));
+
+    /*
+     * Give each byte that occurs in a pattern its own class, and lump
+     * all other bytes together in class 0.
+     */
+
+    size_t total = 0;
+    for (int p = 0; p < npatterns; p++) {
+        for (const unsigned char *b = (const unsigned char *)patterns[p]; *b; b++) {
+            if (ac->byteClass[*b] == 0)
+                ac->byteClass[*b] = (unsigned char)++ac->nclasses;
+            total++;
+        }
+    }
+    ac->nclasses++;
+
+    // the trie has at most one state per pattern byte, plus the root
+    size_t maxStates = total + 1;
+
+    ac->npatterns = npatterns;
+    ac->next = (int32_t *)malloc(maxStates * ac->nclasses * sizeof(int32_t));
+    ac->match = (int32_t *)malloc(maxStates * sizeof(int32_t));
+    ac->dict = (int32_t *)malloc(maxStates * sizeof(int32_t));
+    ac->same = (int32_t *)malloc((npatterns ? npatterns : 1) * sizeof(int32_t));
+
+    // the failure links and the queue are only needed while building
+    int32_t *fail = (int32_t *)malloc(maxStates * sizeof(int32_t));
+    int32_t *queue = (int32_t *)malloc(maxStates * sizeof(int32_t));
+
+    if (!ac->next || !ac->match || !ac->dict || !ac->same || !fail || !queue) {
+        free(fail);
+        free(queue);
+        freeAhoCorasick(ac);
+        return -1;
+    }
+
+    /*
+     * Build the trie, with -1 for missing children.  A pattern that
+     * ends where an earlier one did is chained to it through 'same'.
+     */
+
+    int nclasses = ac->nclasses;
+    int32_t *next = ac->next;
+
+    newState(ac);
+
+    for (int p = 0; p < npatterns; p++) {
+        int32_t s = 0;
+
+        for (const unsigned char *b = (const unsigned char *)patterns[p]; *b; b++) {
+            int32_t c = ac->byteClass[*b];
+            if (next[s * nclasses + c] < 0) {
+                int32_t t = newState(ac);
+                next[s * nclasses + c] = t;
+            }
+            s = next[s * nclasses + c];
+        }
+
+        ac->same[p] = ac->match[s];
+        ac->match[s] = p;
+    }
+
+    /*
+     * Walk the trie breadth first, so that a state's failure link,
+     * which is shallower, is done before the state itself.  A missing
+     * child becomes the transition its failure link takes on the same
+     * byte, and a child's failure link is where its parent's failure
+     * link goes on the child's byte.
+     *
+     * The dictionary links skip the root: patterns ending there are
+     * empty, and matchAhoCorasick() reports those just once.
+     */
+
+    size_t head = 0, tail = 0;
+
+    for (int c = 0; c < nclasses; c++) {
+        int32_t t = next[c];
+        if (t < 0) {
+            next[c] = 0;
+        } else {
+            fail[t] = 0;
+            queue[tail++] = t;
+        }
+    }
+
+    while (head < tail) {
+        int32_t s = queue[head++];
+
+        for (int c = 0; c < nclasses; c++) {
+            int32_t t = next[s * nclasses + c];
+            int32_t f = next[fail[s] * nclasses + c];
+
+            if (t < 0) {
+                next[s * nclasses + c] = f;
+            } else {
+                fail[t] = f;
+                ac->dict[t] = (f != 0 && ac->match[f] >= 0) ? f : ac->dict[f];
+                queue[tail++] = t;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+void matchAhoCorasick(const struct AhoCorasick *ac, const char *text,
+    size_t len, void (*f)(int pattern, void *arg), void *arg)
+{
+    if (ac->nstates == 0)
+        return;
+
+    for (int32_t p = ac->match[0]; p >= 0; p = ac->same[p])
+        f(p, arg);
+
+    const unsigned char *b = (const unsigned char *)text;
+    const int32_t *next = ac->next;
+    int nclasses = ac->nclasses;
+    int32_t s = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        s = next[s * nclasses + ac->byteClass[b[i]]];
+
+        // report the pattern ending here, if any, and those on the
+        // dictionary links; the root's were reported up front
+        if (s == 0)
+            continue;
+        for (int32_t d = ac->match[s] >= 0 ? s : ac->dict[s]; d >= 0; d = ac->dict[d]) {
+            for (int32_t p = ac->match[d]; p >= 0; p = ac->same[p])
+                f(p, arg);
+        }
+    }
+}
+
+/*
+ * While matching columns, 'rec' is the record being matched, and
+ * last[p] is one more than the last record appended for pattern p.
+ */
+struct ColumnScan {
+    struct Vec *const *matches;
+    uint32_t *last;
+    uint32_t rec;
+    int failed;
+};
+
+static void addColumnMatch(int pattern, void *arg)
+{
+    struct ColumnScan *scan = (struct ColumnScan *)arg;
+
+    if (scan->last[pattern] == scan->rec + 1)
+        return;
+    scan->last[pattern] = scan->rec + 1;
+    if (pushRecVec(scan->matches[pattern], &scan->rec) == NULL)
+        scan->failed = 1;
+}
+
+int matchAhoCorasickColumns(const char *const *patterns, int npatterns,
+    const struct TextColumn *columns, int ncolumns, size_t count,
+    struct Vec *const *matches)
+{
+    if (npatterns == 0)
+        return 0;
+
+    struct AhoCorasick ac;
+    uint32_t *last = (uint32_t *)calloc(npatterns, sizeof(uint32_t));
+
+    if (last == NULL || buildAhoCorasick(&ac, patterns, npatterns) < 0) {
+        free(last);
+        return -1;
+    }
+
+    struct ColumnScan scan = { matches, last, 0, 0 };
+
+    for (size_t i = 0; i < count && !scan.failed; i++) {
+        scan.rec = (uint32_t)i;
+        for (int c = 0; c < ncolumns; c++) {
+            const char *field = columns[c].base + i * columns[c].stride;
+
+            matchAhoCorasick(&ac, field, strnlen(field, columns[c].width),
+                &addColumnMatch, &scan);
+        }
+    }
+
+    freeAhoCorasick(&ac);
+    free(last);
+    return scan.failed ? -1 : 0;
+}
@@ -0,0 +1,95 @@
+#ifndef _MYAHO_H_
+#define _MYAHO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "myvec.h"
+
+/*
+ * An Aho-Corasick automaton: finds which of many patterns occur in a
+ * text in a single pass over the text, however many patterns there
+ * are.
+ *
+ * The patterns are stored in a trie, and each state also has a failure
+ * link to the state for the longest proper suffix of its string that
+ * is in the trie.  Following the failure links ahead of time turns the
+ * trie into a DFA, so scanning a text takes exactly one table lookup
+ * per byte.  A state is marked with the pattern that ends there, and
+ * linked to the nearest state along its failure links where another
+ * pattern ends, so the patterns ending at each position can be listed
+ * without walking the failure links during the scan.
+ *
+ * Bytes that occur in no pattern all behave the same, so the DFA only
+ * has a column for each distinct byte of the patterns plus one for the
+ * rest, which keeps it small for the short printable keys it is meant
+ * for.
+ */
+
+struct AhoCorasick {
+    unsigned char byteClass[256];
+    int nclasses;
+    int nstates;
+    int npatterns;
+    int32_t *next;
+    int32_t *match;
+    int32_t *dict;
+    int32_t *same;
+};
+
+/*
+ * Build an automaton for the 'npatterns' null-terminated strings in
+ * 'patterns', which are numbered from 0 in that order.  The automaton
+ * doesn't point into the patterns, so they don't have to outlive it.
+ * Patterns may repeat, and may be empty.
+ *
+ * Returns 0 on success and -1 if memory ran out, leaving 'ac' empty.
+ * An empty automaton matches nothing and can be freed.
+ */
+int buildAhoCorasick(struct AhoCorasick *ac, const char *const *patterns,
+    int npatterns);
+
+/*
+ * Call f() with the number of each pattern that occurs in the 'len'
+ * bytes at 'text', and with 'arg'.  f() is called once for each place
+ * a nonempty pattern occurs, so it may be called several times for the
+ * same pattern.  An empty pattern is reported once, even for an empty
+ * text.
+ */
+void matchAhoCorasick(const struct AhoCorasick *ac, const char *text,
+    size_t len, void (*f)(int pattern, void *arg), void *arg);
+
+/*
+ * Free the automaton, leaving it empty.
+ */
+void freeAhoCorasick(struct AhoCorasick *ac);
+
+/*
+ * A text field of each of a run of records: the field of record i is
+ * the 'width' bytes at base + i * stride, holding a string that is
+ * null-terminated unless it fills the whole field.  The fields of a
+ * record can live in one struct or in separate columns.
+ */
+struct TextColumn {
+    const char *base;
+    size_t stride;
+    size_t width;
+};
+
+/*
+ * Match the 'npatterns' null-terminated 'patterns' against each of
+ * 'count' records in a single pass, and append the record's number to
+ * *matches[p] (a record-mode vector of uint32_t) if patterns[p] occurs
+ * in any of the record's 'ncolumns' fields.  Each field is matched on
+ * its own, so a match can't run from one field into the next, and a
+ * record is appended once however often a pattern occurs in it.  The
+ * numbers come out in increasing order.
+ *
+ * Returns 0, or -1 if memory ran out, in which case the vectors hold
+ * the matches found so far.
+ */
+int matchAhoCorasickColumns(const char *const *patterns, int npatterns,
+    const struct TextColumn *columns, int ncolumns, size_t count,
+    struct Vec *const *matches);
+
+#endif /* #ifndef _MYAHO_H_ */
@@ -0,0 +1,127 @@
+/*
+ * myalloc.c
+ */
+#include <stdlib.h>
+
+#include "myalloc.h"
+
+// Round 'size' up to a multiple of the strictest alignment malloc()
+// guarantees, so that every allocation is suitably aligned.
+static size_t alignUp(size_t size)
+{
+    size_t align = sizeof(max_align_t);
+    return (size + align - 1) / align * align;
+}
+
+static void *arenaAlloc(void *ctx, size_t size)
+{
+    struct Arena *arena = (struct Arena *)ctx;
+    struct ArenaChunk *chunk = arena->chunks;
+
+    size = alignUp(size ? size : 1);
+
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        size_t chunkSize = size > arena->chunkSize ? size : arena->chunkSize;
+
+        chunk = (struct ArenaChunk *)malloc(sizeof(struct ArenaChunk) + chunkSize);
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->size = chunkSize;
+        chunk->used = 0;
+
+        // An oversized chunk goes behind the current one, which may
+        // still have room for later, smaller allocations.
+        if (arena->chunks && size > arena->chunkSize) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+        }
+    }
+
+    void *ptr = (char *)chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+static void arenaFree(void *ctx, void *ptr)
+{
+    // memory is only given back by releaseArena()
+}
+
+void initArena(struct Arena *arena, size_t chunkSize)
+{
+    arena->allocator.alloc = &arenaAlloc;
+    arena->allocator.free = &arenaFree;
+    arena->allocator.release = NULL;
+    arena->allocator.ctx = arena;
+    arena->chunks = NULL;
+    arena->chunkSize = alignUp(chunkSize ? chunkSize : ARENA_DEFAULT_CHUNK);
+}
+
+void releaseArena(struct Arena *arena)
+{
+    struct ArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        struct ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+}
+
+/*
+ * The counting allocator puts a header in front of each allocation to
+ * remember its size.  The header is a full max_align_t wide so that
+ * what follows it stays aligned.
+ */
+union CountHeader {
+    size_t size;
+    max_align_t align;
+};
+
+static void *countingAlloc(void *ctx, size_t size)
+{
+    struct CountingAllocator *counter = (struct CountingAllocator *)ctx;
+
+    union CountHeader *header = (union CountHeader *)allocWith(
+        counter->parent, sizeof(union CountHeader) + size);
+    if (header == NULL)
+        return NULL;
+
+    header->size = size;
+    counter->allocs++;
+    counter->bytes += size;
+    if (counter->bytes > counter->peakBytes)
+        counter->peakBytes = counter->bytes;
+    return header + 1;
+}
+
+static void countingFree(void *ctx, void *ptr)
+{
+    struct CountingAllocator *counter = (struct CountingAllocator *)ctx;
+
+    if (ptr == NULL)
+        return;
+
+    union CountHeader *header = (union CountHeader *)ptr - 1;
+    counter->frees++;
+    counter->bytes -= header->size;
+    freeWith(counter->parent, header);
+}
+
+void initCountingAllocator(struct CountingAllocator *counter,
+    struct Allocator *parent)
+{
+    counter->allocator.alloc = &countingAlloc;
+    counter->allocator.free = &countingFree;
+    counter->allocator.release = NULL;
+    counter->allocator.ctx = counter;
+    counter->parent = parent;
+    counter->allocs = 0;
+    counter->frees = 0;
+    counter->bytes = 0;
+    counter->peakBytes = 0;
+}
@@ -0,0 +1,119 @@
+#ifndef _MYALLOC_H_
+#define _MYALLOC_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/*
+ * An allocator: a pair of malloc()/free()-like callbacks plus the
+ * context they work on, which is passed to them as their first
+ * argument.
+ *
+ * 'release', if not NULL, frees everything the allocator has handed
+ * out in one go.  Only allocators that serve a single list set it (see
+ * struct NodePool in mylist.h), because removeAllNodes() calls it.
+ *
+ * Wherever a struct Allocator pointer may be NULL, NULL means malloc()
+ * and free().
+ */
+struct Allocator {
+    void *(*alloc)(void *ctx, size_t size);
+    void (*free)(void *ctx, void *ptr);
+    void (*release)(void *ctx);
+    void *ctx;
+};
+
+/*
+ * Allocate 'size' bytes from 'allocator', or with malloc() if it is
+ * NULL.  Returns NULL on failure.
+ */
+static inline void *allocWith(struct Allocator *allocator, size_t size)
+{
+    return allocator ? allocator->alloc(allocator->ctx, size) : malloc(size);
+}
+
+/*
+ * Give 'ptr' back to 'allocator', or free() it if 'allocator' is NULL.
+ */
+static inline void freeWith(struct Allocator *allocator, void *ptr)
+{
+    if (allocator)
+        allocator->free(allocator->ctx, ptr);
+    else
+        free(ptr);
+}
+
+/*
+ * A chunk of memory carved up by an Arena.
+ * 'used' of its 'size' bytes of 'data' have been handed out.
+ */
+struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+/*
+ * An arena (or region) allocator.
+ *
+ * Allocations are carved out of chunks of at least 'chunkSize' bytes
+ * by bumping a pointer, and freeing an individual allocation does
+ * nothing.  Instead, releaseArena() frees everything at once, which
+ * makes an arena a good fit for data that all dies at the same time,
+ * e.g. everything a server allocates for one connection.
+ *
+ * Use &arena->allocator wherever a struct Allocator is expected.
+ */
+struct Arena {
+    struct Allocator allocator;
+    struct ArenaChunk *chunks;
+    size_t chunkSize;
+};
+
+#define ARENA_DEFAULT_CHUNK 65536
+
+/*
+ * Initialize an empty arena whose chunks are 'chunkSize' bytes.  If
+ * 'chunkSize' is 0, ARENA_DEFAULT_CHUNK is used.  Allocations larger
+ * than that get a chunk of their own.
+ */
+void initArena(struct Arena *arena, size_t chunkSize);
+
+/*
+ * Free everything allocated from the arena.  The arena is left empty
+ * and can be used again.
+ */
+void releaseArena(struct Arena *arena);
+
+/*
+ * An allocator that passes allocations through to 'parent' (or to
+ * malloc() if 'parent' is NULL) while keeping count of them.
+ *
+ * 'allocs' and 'frees' count calls, 'bytes' is the number of bytes
+ * currently allocated, and 'peakBytes' the largest that 'bytes' has
+ * ever been.  Byte counts are what callers asked for, not including
+ * the few bytes per allocation that the counting allocator adds to
+ * remember each size.
+ *
+ * Use &counter->allocator wherever a struct Allocator is expected.
+ */
+struct CountingAllocator {
+    struct Allocator allocator;
+    struct Allocator *parent;
+    size_t allocs;
+    size_t frees;
+    size_t bytes;
+    size_t peakBytes;
+};
+
+/*
+ * Initialize a counting allocator on top of 'parent', with all counts
+ * at 0.  The counting allocator can't release everything at once.
+ * The only allocator that can is a NodePool, which has no room for
+ * the header in front of a node, so it can't be 'parent' anyway.
+ */
+void initCountingAllocator(struct CountingAllocator *counter,
+    struct Allocator *parent);
+
+#endif /* #ifndef _MYALLOC_H_ */
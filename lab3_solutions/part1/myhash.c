@@ -0,0 +1,227 @@
+/*
+ * myhash.c
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "myhash.h"
+
+#define HASH_MIN_CAPACITY 16
+
+// Number of slots of the old table moved into the new one by each
+// insertion or removal during a resize.  The new table has room for
+// twice as many entries as the old one, so even if every operation is
+// an insertion, the old table is drained long before the new one fills
+// up.
+#define HASH_MIGRATE_SLOTS 8
+
+// Removed entries leave behind a tombstone (rather than an empty slot)
+// so that probing for keys placed after them keeps going.
+static const char tombstone;
+#define TOMBSTONE ((const void *)&tombstone)
+
+void initHash(struct HashMap *map, size_t (*hash)(const void *),
+    int (*compar)(const void *, const void *))
+{
+    memset(&map->cur, 0, sizeof(map->cur));
+    memset(&map->old, 0, sizeof(map->old));
+    map->migrated = 0;
+    map->hash = hash;
+    map->compar = compar;
+}
+
+// Returns the entry for 'key' (whose hash value is 'h') in 'table', or
+// NULL if there is none.
+static struct HashEntry *lookup(struct HashMap *map, struct HashTable *table,
+    const void *key, size_t h)
+{
+    if (table->entries == NULL)
+        return NULL;
+
+    size_t mask = table->capacity - 1;
+
+    // there is always at least one empty slot, so this terminates
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        struct HashEntry *e = &table->entries[i];
+        if (e->key == NULL)
+            return NULL;
+        if (e->key != TOMBSTONE && e->hash == h && map->compar(key, e->key) == 0)
+            return e;
+    }
+}
+
+// Put a new entry into the first free slot for it in 'table'.  The
+// caller makes sure the key isn't already in the table.
+static void place(struct HashTable *table, const void *key, void *value,
+    size_t h)
+{
+    size_t mask = table->capacity - 1;
+    size_t i = h & mask;
+
+    while (table->entries[i].key != NULL && table->entries[i].key != TOMBSTONE)
+        i = (i + 1) & mask;
+
+    if (table->entries[i].key == NULL)
+        table->used++;
+    table->count++;
+
+    table->entries[i].key = key;
+    table->entries[i].value = value;
+    table->entries[i].hash = h;
+}
+
+// Move up to 'slots' slots' worth of entries from the old table into
+// the current one, and free the old table once it's empty.  A moved
+// entry leaves a tombstone behind, so the old table never holds a
+// second copy of an entry that could be found, changed or removed in
+// place of the one in the current table.
+static void migrate(struct HashMap *map, size_t slots)
+{
+    struct HashTable *old = &map->old;
+    if (old->entries == NULL)
+        return;
+
+    while (slots-- > 0 && map->migrated < old->capacity) {
+        struct HashEntry *e = &old->entries[map->migrated++];
+        if (e->key != NULL && e->key != TOMBSTONE) {
+            place(&map->cur, e->key, e->value, e->hash);
+            e->key = TOMBSTONE;
+            e->value = NULL;
+            old->count--;
+        }
+    }
+
+    if (map->migrated == old->capacity) {
+        free(old->entries);
+        memset(old, 0, sizeof(*old));
+        map->migrated = 0;
+    }
+}
+
+// Start moving to a new table.  If the current table is more than half
+// full of entries, the new one is twice as big; otherwise the current
+// table is mostly tombstones, and it's enough to rehash at the same
+// size to get rid of them.
+static int grow(struct HashMap *map)
+{
+    // finish any resize still in progress first
+    migrate(map, (size_t)-1);
+
+    size_t capacity = map->cur.capacity;
+    if (capacity == 0)
+        capacity = HASH_MIN_CAPACITY;
+    else if (map->cur.count * 2 >= capacity)
+        capacity *= 2;
+
+    struct HashEntry *entries =
+        (struct HashEntry *)calloc(capacity, sizeof(struct HashEntry));
+    if (entries == NULL)
+        return -1;
+
+    map->old = map->cur;
+    map->migrated = 0;
+    map->cur.entries = entries;
+    map->cur.capacity = capacity;
+    map->cur.count = 0;
+    map->cur.used = 0;
+
+    // an empty old table (the very first allocation) is dropped here
+    migrate(map, 0);
+    return 0;
+}
+
+int insertHash(struct HashMap *map, const void *key, void *value)
+{
+    migrate(map, HASH_MIGRATE_SLOTS);
+
+    size_t h = map->hash(key);
+    struct HashEntry *e;
+
+    if ((e = lookup(map, &map->cur, key, h)) != NULL
+        || (e = lookup(map, &map->old, key, h)) != NULL) {
+        e->value = value;
+        return 0;
+    }
+
+    // Keep the load factor (counting tombstones) at most 3/4.  If we
+    // can't get a bigger table, carry on as long as at least one slot
+    // stays empty.
+    if ((map->cur.used + 1) * 4 > map->cur.capacity * 3) {
+        if (grow(map) < 0 && map->cur.used + 1 >= map->cur.capacity)
+            return -1;
+    }
+
+    place(&map->cur, key, value, h);
+    return 0;
+}
+
+void *findHash(struct HashMap *map, const void *key)
+{
+    size_t h = map->hash(key);
+    struct HashEntry *e;
+
+    if ((e = lookup(map, &map->cur, key, h)) != NULL
+        || (e = lookup(map, &map->old, key, h)) != NULL)
+        return e->value;
+    return NULL;
+}
+
+void *removeHash(struct HashMap *map, const void *key)
+{
+    migrate(map, HASH_MIGRATE_SLOTS);
+
+    size_t h = map->hash(key);
+    struct HashTable *table = &map->cur;
+    struct HashEntry *e = lookup(map, table, key, h);
+
+    if (e == NULL) {
+        table = &map->old;
+        if ((e = lookup(map, table, key, h)) == NULL)
+            return NULL;
+    }
+
+    void *value = e->value;
+    e->key = TOMBSTONE;
+    e->value = NULL;
+    table->count--;
+    return value;
+}
+
+void traverseHash(struct HashMap *map,
+    void (*f)(const void *key, void *value))
+{
+    struct HashTable *tables[] = { &map->old, &map->cur };
+
+    for (int t = 0; t < 2; t++) {
+        for (size_t i = 0; i < tables[t]->capacity; i++) {
+            struct HashEntry *e = &tables[t]->entries[i];
+            if (e->key != NULL && e->key != TOMBSTONE)
+                f(e->key, e->value);
+        }
+    }
+}
+
+void removeAllHash(struct HashMap *map)
+{
+    free(map->cur.entries);
+    free(map->old.entries);
+    initHash(map, map->hash, map->compar);
+}
+
+size_t hashString(const void *key)
+{
+    // 64-bit FNV-1a
+    const unsigned char *s = (const unsigned char *)key;
+    unsigned long long h = 14695981039346656037ULL;
+
+    while (*s) {
+        h ^= *s++;
+        h *= 1099511628211ULL;
+    }
+    return (size_t)h;
+}
+
+int compareString(const void *key1, const void *key2)
+{
+    return strcmp((const char *)key1, (const char *)key2);
+}
@@ -0,0 +1,118 @@
+#ifndef _MYHASH_H_
+#define _MYHASH_H_
+
+#include <stddef.h>
+
+/*
+ * A hash table mapping keys to values, both given as pointers.  Like
+ * the lists in mylist.h, it does not manage the lifetime of the keys
+ * and values; it only stores the pointers.
+ *
+ * The table uses open addressing with linear probing: entries live
+ * directly in one array, and a key that collides goes in the next free
+ * slot.  Each entry caches its key's hash value, so probing compares
+ * hashes before calling the equality function, and rehashing never
+ * calls the hash function again.
+ *
+ * Resizing is incremental.  When the table gets too full, a table
+ * twice the size is allocated, but entries are moved into it a few
+ * slots at a time by each subsequent operation rather than all at
+ * once, so no single insert pays for rehashing the whole table.  While
+ * a resize is in progress, lookups check both tables.
+ */
+
+/*
+ * A slot in a hash table; see struct HashMap.
+ */
+struct HashEntry {
+    const void *key;
+    void *value;
+    size_t hash;
+};
+
+/*
+ * One array of slots.  'used' counts slots holding an entry or a
+ * tombstone left by a removal, and 'count' only the entries.
+ */
+struct HashTable {
+    struct HashEntry *entries;
+    size_t capacity;
+    size_t count;
+    size_t used;
+};
+
+/*
+ * A hash table.
+ *
+ * 'cur' is where entries are added.  While a resize is in progress,
+ * 'old' is the previous table, from which slots 'migrated' and up
+ * still have to be moved into 'cur' (the slots below are all empty or
+ * tombstones); otherwise old.entries is NULL.
+ *
+ * 'hash' computes the hash value of a key, and 'compar' compares two
+ * keys, returning 0 if they are equal and non-zero otherwise.
+ */
+struct HashMap {
+    struct HashTable cur;
+    struct HashTable old;
+    size_t migrated;
+    size_t (*hash)(const void *key);
+    int (*compar)(const void *key1, const void *key2);
+};
+
+/*
+ * Initialize an empty hash table with the given hash and comparison
+ * functions.  No memory is allocated until the first insertion.
+ */
+void initHash(struct HashMap *map, size_t (*hash)(const void *),
+    int (*compar)(const void *, const void *));
+
+/*
+ * Returns the number of entries in the table.
+ */
+static inline size_t countHash(const struct HashMap *map)
+{
+    return map->cur.count + map->old.count;
+}
+
+/*
+ * Map 'key', which must not be NULL, to 'value', replacing the value
+ * previously mapped to an equal key, if any.
+ *
+ * Returns 0 on success and -1 on failure.
+ */
+int insertHash(struct HashMap *map, const void *key, void *value);
+
+/*
+ * Returns the value mapped to a key equal to 'key', or NULL if there
+ * is none.
+ */
+void *findHash(struct HashMap *map, const void *key);
+
+/*
+ * Remove the entry for a key equal to 'key' and return its value.
+ * Returns NULL if there is no such entry.
+ */
+void *removeHash(struct HashMap *map, const void *key);
+
+/*
+ * Call f() with the key and value of each entry, in no particular
+ * order.  f() must not modify the table.
+ */
+void traverseHash(struct HashMap *map,
+    void (*f)(const void *key, void *value));
+
+/*
+ * Remove all entries and deallocate the table's memory.  The table
+ * can be used again.
+ */
+void removeAllHash(struct HashMap *map);
+
+/*
+ * Hash and comparison functions for keys that are null-terminated
+ * strings.
+ */
+size_t hashString(const void *key);
+int compareString(const void *key1, const void *key2);
+
+#endif /* #ifndef _MYHASH_H_ */
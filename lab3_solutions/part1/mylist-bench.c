@@ -0,0 +1,525 @@
+/*
+ * mylist-bench.c
+ *
+ *  Microbenchmarks for libmylist:
+ *
+ *    - the struct List primitives, at list sizes from CONFIG_MIN_SIZE
+ *      to CONFIG_MAX_SIZE, in ns/op and malloc() calls per op;
+ *    - typed lists (mytypedlist.h) against the void * API;
+ *    - skip list (myskiplist.h) lookups against findNode() on sorted data;
+ *    - queue throughput (myqueue.h).
+ *
+ *  Build it with 'make clean mylist-bench', so that libmylist.a is
+ *  compiled with the same optimization level as the benchmark itself.
+ *  Use it to compare allocator and layout changes: run it before and
+ *  after, on the same machine.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mylist.h"
+#include "myqueue.h"
+#include "myskiplist.h"
+#include "mytypedlist.h"
+
+/** Smallest and largest list sizes for the primitives; sizes go up by 10x. */
+#define CONFIG_MIN_SIZE 1000
+#define CONFIG_MAX_SIZE 10000000
+
+/** Minimum number of operations per measurement; small lists are rebuilt
+ *  this many times over so that the timer has something to measure. */
+#define CONFIG_MIN_OPS 1000000
+
+/** Number of addBack() calls per measurement.  addBack() walks the whole
+ *  list, so it is measured by appending to a list of the given size. */
+#define CONFIG_ADDBACK_OPS 10
+
+/** Typed list sizes to measure: one that fits in cache, and one that doesn't. */
+#define CONFIG_TYPED_SIZES { 10000, 1000000 }
+
+/** Skip list sizes to measure, and the number of lookups timed at each. */
+#define CONFIG_SKIP_SIZES { 1000, 10000, 100000, 1000000 }
+#define CONFIG_SKIP_LOOKUPS 1000
+
+/** Number of items each producer hands to the consumer in the queue benchmarks. */
+#define CONFIG_QUEUE_ITEMS 1000000
+
+/** Maximum number of producer threads in the queue benchmarks. */
+#define CONFIG_MAX_PRODUCERS 4
+
+/** Number of times each measurement is repeated; the best run counts. */
+#define CONFIG_NUM_ROUNDS 10
+
+// Convert timespec to double-precision floating point number, in nanoseconds.
+#define ts2double(ts) ((double)(ts).tv_sec * 1000000000. + (double)(ts).tv_nsec)
+
+DEFINE_LIST(Double, double)
+
+// Accumulates what the visitors see, so that the work cannot be
+// optimized away.
+static double sum;
+
+static void die(const char *message)
+{
+    perror(message);
+    exit(1);
+}
+
+/*
+ * Count allocations by wrapping malloc() at link time (see -Wl,--wrap
+ * in the Makefile), which catches the calls made inside libmylist.a
+ * too.
+ */
+
+void *__real_malloc(size_t size);
+
+static size_t mallocs;
+
+void *__wrap_malloc(size_t size)
+{
+    mallocs++;
+    return __real_malloc(size);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        die("clock_gettime");
+    return ts2double(ts);
+}
+
+static void addDouble(void *data)
+{
+    sum += *(double *)data;
+}
+
+static void addTypedDouble(double *d)
+{
+    sum += *d;
+}
+
+static int compareTypedDouble(const void *data, const double *d)
+{
+    return *(const double *)data != *d;
+}
+
+/*
+ * struct List primitives.
+ *
+ * Each measurement runs an operation 'ops' times in total (over 'reps'
+ * lists of size n) and reports the average time and number of malloc()
+ * calls per operation.
+ */
+
+struct Measurement {
+    double start;
+    size_t mallocs;
+};
+
+static void begin(struct Measurement *m)
+{
+    m->mallocs = mallocs;
+    m->start = now();
+}
+
+static void end(struct Measurement *m, const char *what, size_t n, size_t ops)
+{
+    double elapsed = now() - m->start;
+    printf("%-16s %9zu elems %10.3f ns/op %6.2f mallocs/op\n",
+        what, n, elapsed / ops, (double)(mallocs - m->mallocs) / ops);
+}
+
+static void benchList(size_t n, double *values)
+{
+    size_t reps = n < CONFIG_MIN_OPS ? CONFIG_MIN_OPS / n : 1;
+    struct List *lists = (struct List *)malloc(reps * sizeof(struct List));
+    if (lists == NULL)
+        die("malloc");
+
+    struct Measurement m;
+    double missing = -1.0;
+    size_t r, i;
+
+    for (r = 0; r < reps; r++)
+        initList(&lists[r]);
+
+    begin(&m);
+    for (r = 0; r < reps; r++) {
+        for (i = 0; i < n; i++) {
+            if (addFront(&lists[r], values + i) == NULL)
+                die("addFront");
+        }
+    }
+    end(&m, "addFront()", n, reps * n);
+
+    begin(&m);
+    for (r = 0; r < reps; r++)
+        traverseList(&lists[r], &addDouble);
+    end(&m, "traverseList()", n, reps * n);
+
+    // an unsuccessful search visits every node
+    begin(&m);
+    for (r = 0; r < reps; r++) {
+        if (findNode(&lists[r], &missing, &compareDouble) != NULL)
+            die("findNode");
+    }
+    end(&m, "findNode()", n, reps * n);
+
+    begin(&m);
+    for (r = 0; r < reps; r++)
+        reverseList(&lists[r]);
+    end(&m, "reverseList()", n, reps * n);
+
+    begin(&m);
+    for (r = 0; r < reps; r++) {
+        while (popFront(&lists[r]) != NULL)
+            ;
+    }
+    end(&m, "popFront()", n, reps * n);
+
+    // build the lists again, front to back this time
+    begin(&m);
+    for (r = 0; r < reps; r++) {
+        struct Node *node = NULL;
+        for (i = 0; i < n; i++) {
+            if ((node = addAfter(&lists[r], node, values + i)) == NULL)
+                die("addAfter");
+        }
+    }
+    end(&m, "addAfter()", n, reps * n);
+
+    begin(&m);
+    for (i = 0; i < CONFIG_ADDBACK_OPS; i++) {
+        if (addBack(&lists[0], values + i) == NULL)
+            die("addBack");
+    }
+    end(&m, "addBack()", n, CONFIG_ADDBACK_OPS);
+
+    begin(&m);
+    for (r = 0; r < reps; r++)
+        removeAllNodes(&lists[r]);
+    end(&m, "removeAllNodes()", n, reps * n);
+
+    free(lists);
+}
+
+// Print the best of 'times' as nanoseconds per element.
+static void report(const char *what, size_t n, double *times)
+{
+    double best = times[0];
+    for (int round = 1; round < CONFIG_NUM_ROUNDS; round++)
+        best = times[round] < best ? times[round] : best;
+
+    printf("%-32s %8zu elems %8.3f ns/elem\n", what, n, best / n);
+}
+
+static void bench(size_t n)
+{
+    double *values = (double *)malloc(n * sizeof(double));
+    if (values == NULL)
+        die("malloc");
+
+    /*
+     * Build a void * list and a typed list holding the same values.
+     */
+
+    struct List list;
+    struct DoubleList dlist;
+    struct Node *node = NULL;
+    struct DoubleNode *dnode = NULL;
+    initList(&list);
+    initDoubleList(&dlist);
+
+    for (size_t i = 0; i < n; i++) {
+        values[i] = i;
+        if ((node = addAfter(&list, node, values + i)) == NULL)
+            die("addAfter");
+        if ((dnode = addDoubleAfter(&dlist, dnode, values[i])) == NULL)
+            die("addDoubleAfter");
+    }
+
+    /*
+     * Time traversal and (unsuccessful, so full-length) search.
+     */
+
+    double times[CONFIG_NUM_ROUNDS];
+    double missing = -1.0;
+    double start;
+
+    for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+        start = now();
+        traverseList(&list, &addDouble);
+        times[round] = now() - start;
+    }
+    report("traverseList()", n, times);
+
+    for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+        start = now();
+        traverseDoubleList(&dlist, &addTypedDouble);
+        times[round] = now() - start;
+    }
+    report("traverseDoubleList() (typed)", n, times);
+
+    for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+        start = now();
+        if (findNode(&list, &missing, &compareDouble) != NULL)
+            die("findNode");
+        times[round] = now() - start;
+    }
+    report("findNode()", n, times);
+
+    for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+        start = now();
+        if (findDoubleNode(&dlist, &missing, &compareTypedDouble) != NULL)
+            die("findDoubleNode");
+        times[round] = now() - start;
+    }
+    report("findDoubleNode() (typed)", n, times);
+
+    removeAllNodes(&list);
+    removeAllDoubleNodes(&dlist);
+    free(values);
+}
+
+/*
+ * Skip list against a sorted struct List: the same n values are looked
+ * up in both, CONFIG_SKIP_LOOKUPS times, spread evenly over the range.
+ * findNode() has to walk half the list on average.
+ */
+
+static int orderDouble(const void *data1, const void *data2)
+{
+    double d1 = *(const double *)data1, d2 = *(const double *)data2;
+    return (d1 > d2) - (d1 < d2);
+}
+
+static void benchSkipList(size_t n, double *values)
+{
+    struct List list;
+    struct SkipList slist;
+    struct Node *node = NULL;
+    struct Measurement m;
+    size_t i;
+
+    initList(&list);
+    initSkipList(&slist, &orderDouble);
+
+    for (i = 0; i < n; i++) {
+        if ((node = addAfter(&list, node, values + i)) == NULL)
+            die("addAfter");
+    }
+
+    begin(&m);
+    for (i = 0; i < n; i++) {
+        if (insertSkipList(&slist, values + i) == NULL)
+            die("insertSkipList");
+    }
+    end(&m, "insertSkipList()", n, n);
+
+    size_t step = n / CONFIG_SKIP_LOOKUPS ? n / CONFIG_SKIP_LOOKUPS : 1;
+    size_t lookups = 0;
+
+    begin(&m);
+    for (i = 0; i < n; i += step, lookups++) {
+        if (findNode(&list, values + i, &compareDouble) == NULL)
+            die("findNode");
+    }
+    end(&m, "findNode()", n, lookups);
+
+    begin(&m);
+    for (i = 0; i < n; i += step) {
+        if (findSkipList(&slist, values + i) == NULL)
+            die("findSkipList");
+    }
+    end(&m, "findSkipList()", n, lookups);
+
+    // scan the middle tenth of the items
+    begin(&m);
+    traverseRangeSkipList(&slist, values + n / 2, values + n / 2 + n / 10,
+        &addDouble);
+    end(&m, "range scan", n, n / 10 ? n / 10 : 1);
+
+    begin(&m);
+    for (i = 0; i < n; i++) {
+        if (removeSkipList(&slist, values + i) == NULL)
+            die("removeSkipList");
+    }
+    end(&m, "removeSkipList()", n, n);
+
+    removeAllNodes(&list);
+}
+
+/*
+ * Queue throughput: producers hand preallocated nodes to one consumer
+ * through an MpscQueue or an SpscRing.  For comparison, they also go
+ * through a TList guarded by a mutex, which has to allocate a node of
+ * its own per item.  The consumer yields whenever it finds nothing to
+ * do.
+ */
+
+struct QueueBench {
+    struct MpscQueue mpsc;
+    struct SpscRing spsc;
+    struct TList tlist;
+    pthread_mutex_t mutex;
+    struct Node *nodes;
+};
+
+struct Producer {
+    struct QueueBench *qb;
+    struct Node *nodes;
+};
+
+static void *produceMpsc(void *arg)
+{
+    struct Producer *p = (struct Producer *)arg;
+
+    for (size_t i = 0; i < CONFIG_QUEUE_ITEMS; i++)
+        pushMpscQueue(&p->qb->mpsc, &p->nodes[i]);
+    return NULL;
+}
+
+static void *produceLocked(void *arg)
+{
+    struct Producer *p = (struct Producer *)arg;
+
+    for (size_t i = 0; i < CONFIG_QUEUE_ITEMS; i++) {
+        pthread_mutex_lock(&p->qb->mutex);
+        if (addBackTList(&p->qb->tlist, &p->nodes[i]) == NULL)
+            die("addBackTList");
+        pthread_mutex_unlock(&p->qb->mutex);
+    }
+    return NULL;
+}
+
+static void *produceSpsc(void *arg)
+{
+    struct Producer *p = (struct Producer *)arg;
+
+    for (size_t i = 0; i < CONFIG_QUEUE_ITEMS; i++) {
+        while (pushSpscRing(&p->qb->spsc, &p->nodes[i]) < 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+// Start 'nprod' producers running 'produce', consume everything they
+// send using 'consume' (which returns NULL when it finds nothing), and
+// report the throughput.
+static void runQueue(const char *what, struct QueueBench *qb, int nprod,
+    void *(*produce)(void *), void *(*consume)(struct QueueBench *))
+{
+    pthread_t threads[CONFIG_MAX_PRODUCERS];
+    struct Producer producers[CONFIG_MAX_PRODUCERS];
+    size_t total = (size_t)nprod * CONFIG_QUEUE_ITEMS;
+
+    double start = now();
+
+    for (int i = 0; i < nprod; i++) {
+        producers[i].qb = qb;
+        producers[i].nodes = qb->nodes + (size_t)i * CONFIG_QUEUE_ITEMS;
+        if (pthread_create(&threads[i], NULL, produce, &producers[i]))
+            die("pthread_create");
+    }
+
+    for (size_t received = 0; received < total;) {
+        if (consume(qb))
+            received++;
+        else
+            sched_yield();
+    }
+
+    for (int i = 0; i < nprod; i++)
+        pthread_join(threads[i], NULL);
+
+    double elapsed = now() - start;
+    printf("%-32s %d producer(s) %8.3f ns/item %8.2f Mitems/s\n",
+        what, nprod, elapsed / total, total / elapsed * 1000.);
+}
+
+static void *consumeMpsc(struct QueueBench *qb)
+{
+    return popMpscQueue(&qb->mpsc);
+}
+
+static void *consumeLocked(struct QueueBench *qb)
+{
+    pthread_mutex_lock(&qb->mutex);
+    void *data = popFrontTList(&qb->tlist);
+    pthread_mutex_unlock(&qb->mutex);
+    return data;
+}
+
+static void *consumeSpsc(struct QueueBench *qb)
+{
+    return popSpscRing(&qb->spsc);
+}
+
+static void benchQueues(void)
+{
+    struct QueueBench qb;
+
+    qb.nodes = (struct Node *)malloc(
+        (size_t)CONFIG_MAX_PRODUCERS * CONFIG_QUEUE_ITEMS * sizeof(struct Node));
+    if (qb.nodes == NULL)
+        die("malloc");
+
+    initMpscQueue(&qb.mpsc);
+    initTList(&qb.tlist);
+    if (pthread_mutex_init(&qb.mutex, NULL))
+        die("pthread_mutex_init");
+    if (initSpscRing(&qb.spsc, 1024) < 0)
+        die("initSpscRing");
+
+    for (int nprod = 1; nprod <= CONFIG_MAX_PRODUCERS; nprod *= 2) {
+        runQueue("MpscQueue", &qb, nprod, &produceMpsc, &consumeMpsc);
+        runQueue("TList + mutex", &qb, nprod, &produceLocked, &consumeLocked);
+    }
+    runQueue("SpscRing", &qb, 1, &produceSpsc, &consumeSpsc);
+
+    pthread_mutex_destroy(&qb.mutex);
+    freeSpscRing(&qb.spsc);
+    free(qb.nodes);
+}
+
+int main()
+{
+    double *values = (double *)malloc(CONFIG_MAX_SIZE * sizeof(double));
+    if (values == NULL)
+        die("malloc");
+    for (size_t i = 0; i < CONFIG_MAX_SIZE; i++)
+        values[i] = i;
+
+    for (size_t n = CONFIG_MIN_SIZE; n <= CONFIG_MAX_SIZE; n *= 10) {
+        benchList(n, values);
+        printf("\n");
+    }
+
+    size_t sizes[] = CONFIG_TYPED_SIZES;
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        bench(sizes[i]);
+    printf("\n");
+
+    size_t skipSizes[] = CONFIG_SKIP_SIZES;
+
+    for (size_t i = 0; i < sizeof(skipSizes) / sizeof(skipSizes[0]); i++) {
+        benchSkipList(skipSizes[i], values);
+        printf("\n");
+    }
+    free(values);
+
+    benchQueues();
+
+    // Keep the compiler from discarding the traversals.
+    if (sum < 0)
+        printf("%f\n", sum);
+
+    return 0;
+}
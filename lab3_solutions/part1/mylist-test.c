@@ -1,20 +1,657 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "myaho.h"
+#include "myalloc.h"
+#include "myhash.h"
 #include "mylist.h"
+#include "myqueue.h"
+#include "myscan.h"
+#include "myskiplist.h"
+#include "mytrigram.h"
+#include "mytypedlist.h"
+#include "myulist.h"
+#include "myvec.h"
 
 static void printDouble(void *p)
 {
     printf("%.1f ", *(double *)p);
 }
 
+DEFINE_LIST(Double, double)
+
+static void printTypedDouble(double *p)
+{
+    printf("%.1f ", *p);
+}
+
+static int compareTypedDouble(const void *data, const double *d)
+{
+    return *(const double *)data != *d;
+}
+
+struct Elem {
+    double value;
+    struct Link link;
+};
+
+static void printElem(struct Link *link)
+{
+    printf("%.1f ", containerOf(link, struct Elem, link)->value);
+}
+
+static int orderDouble(const void *data1, const void *data2)
+{
+    double d1 = *(double *)data1, d2 = *(double *)data2;
+    return (d1 > d2) - (d1 < d2);
+}
+
+static int orderElem(const struct Link *link1, const struct Link *link2)
+{
+    return orderDouble(&containerOf(link1, struct Elem, link)->value,
+        &containerOf(link2, struct Elem, link)->value);
+}
+
+static int compareElem(const void *data, const struct Link *link)
+{
+    return compareDouble(data, &containerOf(link, struct Elem, link)->value);
+}
+
 static void die(const char *message)
 {
     perror(message);
     exit(1);
 }
 
+// Add up the values in a hash table whose values point to doubles.
+static double hashSum;
+
+static void sumHashValue(const void *key, void *value)
+{
+    hashSum += *(double *)value;
+}
+
+static void testHash(void)
+{
+    double values[1000];
+    char keys[1000][8];
+    int n = sizeof(values) / sizeof(values[0]);
+    int i, resized = 0;
+    struct HashMap map;
+
+    initHash(&map, &hashString, &compareString);
+
+    printf("testing insertHash(): ");
+    for (i = 0; i < n; i++) {
+        values[i] = i;
+        sprintf(keys[i], "%d", i);
+        if (insertHash(&map, keys[i], values + i) < 0)
+            die("insertHash() failed");
+        if (map.old.entries)
+            resized = 1;
+    }
+    assert(resized && countHash(&map) == n);
+    printf("%zu entries\n", countHash(&map));
+
+    printf("testing findHash(): ");
+    for (i = 0; i < n; i++) {
+        char key[8];
+        sprintf(key, "%d", i);
+        assert(findHash(&map, key) == values + i);
+    }
+    assert(findHash(&map, "dude") == NULL);
+    printf("OK\n");
+
+    printf("testing removeHash(): ");
+    for (i = 0; i < n; i += 2) {
+        void *removed = removeHash(&map, keys[i]);
+        assert(removed == values + i);
+    }
+    void *again = removeHash(&map, keys[0]);
+    assert(again == NULL);
+    for (i = 0; i < n; i++)
+        assert(findHash(&map, keys[i]) == (i % 2 ? values + i : NULL));
+    printf("%zu entries\n", countHash(&map));
+
+    printf("testing insertHash() replacing values: ");
+    for (i = 1; i < n; i += 2)
+        insertHash(&map, keys[i], values);
+    assert(countHash(&map) == n / 2 && findHash(&map, "999") == values);
+    printf("%zu entries\n", countHash(&map));
+
+    printf("testing traverseHash(): ");
+    for (i = 0; i < n; i += 2)
+        insertHash(&map, keys[i], values + i);
+    hashSum = 0;
+    traverseHash(&map, &sumHashValue);
+    printf("%.1f\n", hashSum);
+
+    removeAllHash(&map);
+    assert(countHash(&map) == 0 && findHash(&map, "1") == NULL);
+
+    // Remove and re-insert keys while a big table is being migrated,
+    // so that some of them have already been moved and some haven't.
+    printf("testing removeHash() during a resize: ");
+    for (i = 0; map.old.capacity < 512 || map.migrated < map.old.capacity / 4;
+        i++) {
+        if (insertHash(&map, keys[i], values + i) < 0)
+            die("insertHash() failed");
+    }
+    int m = i;
+    for (i = 0; i < m && map.old.entries != NULL; i++) {
+        void *removed = removeHash(&map, keys[i]);
+        void *found = findHash(&map, keys[i]);
+        assert(removed == values + i && found == NULL);
+        if (insertHash(&map, keys[i], values + i) < 0)
+            die("insertHash() failed");
+    }
+    assert(i > 0 && map.old.entries == NULL);
+    for (i = m; i < n; i++) {
+        if (insertHash(&map, keys[i], values + i) < 0)
+            die("insertHash() failed");
+    }
+    for (i = 0; i < n; i++)
+        assert(findHash(&map, keys[i]) == values + i);
+    hashSum = 0;
+    traverseHash(&map, &sumHashValue);
+    assert(countHash(&map) == n && hashSum == 499500);
+    printf("%zu entries\n", countHash(&map));
+
+    removeAllHash(&map);
+}
+
+static void testSkipList(void)
+{
+    double values[1000];
+    int n = sizeof(values) / sizeof(values[0]);
+    int i;
+    struct SkipList slist;
+    struct SkipNode *snode;
+
+    initSkipList(&slist, &orderDouble);
+
+    // insert 0..999 out of order (337 is coprime with 1000)
+    printf("testing insertSkipList(): ");
+    for (i = 0; i < n; i++) {
+        values[i] = (i * 337) % n;
+        if (insertSkipList(&slist, values + i) == NULL)
+            die("insertSkipList() failed");
+    }
+    assert(lengthSkipList(&slist) == (size_t)n);
+    snode = firstSkipNode(&slist);
+    for (i = 0; snode; snode = nextSkipNode(snode))
+        assert(*(double *)snode->data == i++);
+    printf("%zu items, %d levels\n", lengthSkipList(&slist), slist.level);
+
+    printf("testing findSkipList() and lowerBoundSkipList(): ");
+    double key = 500.0, half = 499.5, past = 1000.0;
+    assert(*(double *)findSkipList(&slist, &key)->data == 500.0);
+    assert(findSkipList(&slist, &half) == NULL);
+    assert(*(double *)lowerBoundSkipList(&slist, &half)->data == 500.0);
+    assert(lowerBoundSkipList(&slist, &past) == NULL);
+    printf("OK\n");
+
+    // equal items stay in insertion order
+    double dup = 500.0;
+    snode = insertSkipList(&slist, &dup);
+    assert(snode == findSkipList(&slist, &key)->next[0]);
+
+    printf("testing traverseRangeSkipList(): ");
+    double low = 497.5, high = 503.0;
+    traverseRangeSkipList(&slist, &low, &high, &printDouble);
+    printf("\n");
+
+    printf("testing removeSkipList(): ");
+    void *first = removeSkipList(&slist, &key);
+    void *second = removeSkipList(&slist, &key);
+    void *third = removeSkipList(&slist, &key);
+    assert(first != &dup && second == &dup && third == NULL);
+    for (i = 0; i < n; i += 2) {
+        if (values[i] != key) {
+            void *removed = removeSkipList(&slist, values + i);
+            assert(removed == values + i);
+        }
+    }
+    traverseRangeSkipList(&slist, &low, &high, &printDouble);
+    printf("\n");
+    assert(lengthSkipList(&slist) == (size_t)n / 2);
+
+    removeAllSkipList(&slist);
+    assert(isEmptySkipList(&slist) && lengthSkipList(&slist) == 0);
+}
+
+/*
+ * Trigram index over records with two text fields, the second of which
+ * is sometimes filled up to the last byte without a terminator.
+ */
+
+struct TextRec {
+    char name[8];
+    char msg[8];
+};
+
+static void printCandidates(const struct Vec *ids)
+{
+    for (size_t i = 0; i < vecLength(ids); i++)
+        printf("%u ", *(uint32_t *)vecAt(ids, i));
+    printf("\n");
+}
+
+static void testTrigram(void)
+{
+    struct TextRec recs[] = {
+        { "alice", "hello" },
+        { "bob", "say hi!!" },
+        { "carol", "alice" },
+        { "dave", "yellow" },
+        { "al", "hell" },
+    };
+    size_t n = sizeof(recs) / sizeof(recs[0]);
+    struct TextField fields[] = {
+        { offsetof(struct TextRec, name), sizeof(recs[0].name) },
+        { offsetof(struct TextRec, msg), sizeof(recs[0].msg) },
+    };
+    struct TrigramIndex index, loaded;
+    struct Vec ids;
+
+    initTrigramIndex(&index);
+    initTrigramIndex(&loaded);
+    initRecVec(&ids, sizeof(uint32_t));
+
+    printf("testing buildTrigramIndex(): ");
+    if (buildTrigramIndex(&index, recs, n, sizeof(recs[0]), fields, 2) < 0)
+        die("buildTrigramIndex() failed");
+    assert(index.count == n);
+    printf("%zu trigrams\n", index.ntrigrams);
+
+    printf("testing findTrigramCandidates(): ");
+    int found[5];
+    found[0] = findTrigramCandidates(&index, "al", &ids);
+    found[1] = findTrigramCandidates(&index, "alice", &ids);
+    found[2] = findTrigramCandidates(&index, "ell", &ids);
+    found[3] = findTrigramCandidates(&index, "hi!!", &ids);
+    found[4] = findTrigramCandidates(&index, "zzz", &ids);
+    assert(found[0] == -1 && found[1] == 2 && found[2] == 3
+        && found[3] == 1 && found[4] == 0);
+    printCandidates(&ids);
+
+    printf("testing saveTrigramIndex() and loadTrigramIndex(): ");
+    if (saveTrigramIndex(&index, "mylist-test.tri") < 0)
+        die("saveTrigramIndex() failed");
+    if (loadTrigramIndex(&loaded, "mylist-test.tri") < 0)
+        die("loadTrigramIndex() failed");
+    unlink("mylist-test.tri");
+    assert(loaded.mapped && loaded.count == n
+        && loaded.ntrigrams == index.ntrigrams);
+    clearVec(&ids);
+    found[0] = findTrigramCandidates(&loaded, "ello", &ids);
+    assert(found[0] == 2);
+    printCandidates(&ids);
+
+    printf("testing checkTrigramIndex(): ");
+    struct TextRec changed[sizeof(recs) / sizeof(recs[0])];
+    memcpy(changed, recs, sizeof(recs));
+    changed[3].msg[0] = 'Y';
+    int belongs[4];
+    belongs[0] = checkTrigramIndex(&loaded, recs, n, sizeof(recs[0]));
+    belongs[1] = checkTrigramIndex(&loaded, recs, n - 1, sizeof(recs[0]));
+    belongs[2] = checkTrigramIndex(&loaded, changed, n, sizeof(recs[0]));
+    belongs[3] = checkTrigramIndex(&loaded, recs, n, sizeof(recs[0]) / 2);
+    assert(belongs[0] && !belongs[1] && !belongs[2] && !belongs[3]);
+    printf("OK\n");
+
+    found[0] = loadTrigramIndex(&loaded, "mylist-test.c");
+    assert(found[0] == -1 && loaded.block == NULL);
+
+    freeVec(&ids);
+    freeTrigramIndex(&index);
+    freeTrigramIndex(&loaded);
+}
+
+/*
+ * Field scan kernels: every kernel the CPU supports must agree with
+ * strstr() on fields laid out as an array of structs and as columns.
+ * The fields are random strings over a small alphabet, some filling
+ * their whole width and some with junk after the null terminator.
+ */
+
+#define SCAN_RECS 1000
+
+struct ScanRec {
+    char name[16];
+    char msg[24];
+};
+
+static void fillField(char *field, size_t width)
+{
+    for (size_t i = 0; i < width; i++)
+        field[i] = "abcd"[rand() % 4];
+    size_t len = (size_t)rand() % (width + 1);
+    if (len < width)
+        field[len] = '\0';
+}
+
+static int fieldHasKey(const char *field, size_t width, const char *key)
+{
+    char buf[64];
+    memcpy(buf, field, width);
+    buf[width] = '\0';
+    return strstr(buf, key) != NULL;
+}
+
+static void testScan(void)
+{
+    // exactly sized heap blocks, so that a kernel reading past the last
+    // field trips the address sanitizer
+    struct ScanRec *recs = (struct ScanRec *)malloc(SCAN_RECS * sizeof(*recs));
+    char *names = (char *)malloc(SCAN_RECS * 16);
+    unsigned char *hits = (unsigned char *)malloc(SCAN_RECS);
+    if (!recs || !names || !hits)
+        die("malloc failed");
+
+    srand(3157);
+    for (int i = 0; i < SCAN_RECS; i++) {
+        fillField(recs[i].name, sizeof(recs[i].name));
+        fillField(recs[i].msg, sizeof(recs[i].msg));
+        memcpy(names + i * 16, recs[i].name, 16);
+    }
+
+    const char *keys[] = { "", "a", "d", "ab", "ba", "abc", "dcba", "aaaaa",
+        "abcda", "e", "abcdabcdabcdabcd" };
+    int nkeys = sizeof(keys) / sizeof(keys[0]);
+    size_t total = 0;
+    enum ScanKernel best = bestScanKernel();
+
+    printf("testing scanFields(): ");
+    for (int k = 0; k < nkeys; k++) {
+        for (enum ScanKernel kernel = SCAN_SCALAR; kernel <= best; kernel++) {
+            size_t found, expect = 0;
+
+            // names and msgs of the structs, ORed together
+            memset(hits, 0, SCAN_RECS);
+            scanFieldsWith(kernel, recs[0].name, sizeof(recs[0]),
+                sizeof(recs[0].name), SCAN_RECS, keys[k], hits);
+            scanFieldsWith(kernel, recs[0].msg, sizeof(recs[0]),
+                sizeof(recs[0].msg), SCAN_RECS, keys[k], hits);
+            for (int i = 0; i < SCAN_RECS; i++) {
+                int match = fieldHasKey(recs[i].name, 16, keys[k])
+                    || fieldHasKey(recs[i].msg, 24, keys[k]);
+                assert(hits[i] == match);
+                expect += match;
+            }
+            if (kernel == SCAN_SCALAR)
+                total += expect;
+
+            // the names as a column
+            memset(hits, 0, SCAN_RECS);
+            found = scanFieldsWith(kernel, names, 16, 16, SCAN_RECS, keys[k],
+                hits);
+            expect = 0;
+            for (int i = 0; i < SCAN_RECS; i++) {
+                assert(hits[i] == fieldHasKey(names + i * 16, 16, keys[k]));
+                expect += hits[i];
+            }
+            assert(found == expect);
+
+            // just the last field, which the SIMD kernels can't overread
+            const char *last = names + (SCAN_RECS - 1) * 16;
+            memset(hits, 0, SCAN_RECS);
+            scanFieldsWith(kernel, last, 16, 16, 1, keys[k], hits);
+            assert(hits[0] == fieldHasKey(last, 16, keys[k]));
+        }
+    }
+    printf("%zu matches\n", total);
+
+    printf("testing fieldContains(): ");
+    for (int k = 0; k < nkeys; k++) {
+        size_t klen = strlen(keys[k]);
+        for (int i = 0; i < SCAN_RECS; i++) {
+            assert(fieldContains(recs[i].name, 16, keys[k], klen)
+                == fieldHasKey(recs[i].name, 16, keys[k]));
+            assert(fieldContains(recs[i].msg, 24, keys[k], klen)
+                == fieldHasKey(recs[i].msg, 24, keys[k]));
+        }
+    }
+    printf("OK\n");
+
+    free(recs);
+    free(names);
+    free(hits);
+}
+
+/*
+ * Aho-Corasick: the patterns reported for each text must be exactly
+ * those strstr() finds in it.  Patterns and texts are random strings
+ * over a small alphabet, so patterns overlap, nest and repeat.
+ */
+
+#define AHO_PATTERNS 40
+#define AHO_TEXTS 2000
+
+static void markPattern(int pattern, void *arg)
+{
+    ((unsigned char *)arg)[pattern] = 1;
+}
+
+static void randomString(char *s, int maxLen)
+{
+    int len = rand() % (maxLen + 1);
+    for (int i = 0; i < len; i++)
+        s[i] = "abcd"[rand() % 4];
+    s[len] = '\0';
+}
+
+static void testAhoCorasick(void)
+{
+    char patterns[AHO_PATTERNS][6];
+    const char *ptrs[AHO_PATTERNS];
+    unsigned char seen[AHO_PATTERNS];
+    struct AhoCorasick ac;
+
+    srand(3157);
+    for (int p = 0; p < AHO_PATTERNS; p++) {
+        randomString(patterns[p], 5);
+        ptrs[p] = patterns[p];
+    }
+
+    printf("testing matchAhoCorasick(): ");
+    if (buildAhoCorasick(&ac, ptrs, AHO_PATTERNS) < 0)
+        die("buildAhoCorasick() failed");
+
+    size_t total = 0;
+    for (int i = 0; i < AHO_TEXTS; i++) {
+        char text[25];
+        randomString(text, 24);
+
+        memset(seen, 0, sizeof(seen));
+        matchAhoCorasick(&ac, text, strlen(text), &markPattern, seen);
+
+        for (int p = 0; p < AHO_PATTERNS; p++) {
+            assert(seen[p] == (strstr(text, patterns[p]) != NULL));
+            total += seen[p];
+        }
+    }
+    printf("%zu matches in %d states\n", total, ac.nstates);
+
+    /*
+     * matchAhoCorasickColumns() must find each record once per pattern
+     * that strstr() finds in either of its fields, which may fill the
+     * whole field, with no match spanning the two fields.
+     */
+    struct { char name[8]; char msg[8]; } recs[AHO_TEXTS];
+    struct Vec vecs[AHO_PATTERNS];
+    struct Vec *matches[AHO_PATTERNS];
+
+    for (int i = 0; i < AHO_TEXTS; i++) {
+        char s[9];
+        randomString(s, 8);
+        strncpy(recs[i].name, s, sizeof(recs[i].name));
+        randomString(s, 8);
+        strncpy(recs[i].msg, s, sizeof(recs[i].msg));
+    }
+    for (int p = 0; p < AHO_PATTERNS; p++) {
+        initRecVec(&vecs[p], sizeof(uint32_t));
+        matches[p] = &vecs[p];
+    }
+
+    printf("testing matchAhoCorasickColumns(): ");
+    struct TextColumn columns[] = {
+        { recs[0].name, sizeof(recs[0]), sizeof(recs[0].name) },
+        { recs[0].msg, sizeof(recs[0]), sizeof(recs[0].msg) },
+    };
+    int result = matchAhoCorasickColumns(ptrs, AHO_PATTERNS, columns, 2,
+        AHO_TEXTS, matches);
+    assert(result == 0);
+
+    total = 0;
+    for (int p = 0; p < AHO_PATTERNS; p++) {
+        size_t j = 0;
+        for (int i = 0; i < AHO_TEXTS; i++) {
+            char name[9], msg[9];
+            snprintf(name, sizeof(name), "%.8s", recs[i].name);
+            snprintf(msg, sizeof(msg), "%.8s", recs[i].msg);
+            if (strstr(name, patterns[p]) || strstr(msg, patterns[p])) {
+                assert(j < vecLength(&vecs[p]));
+                assert(*(uint32_t *)vecAt(&vecs[p], j) == (uint32_t)i);
+                j++;
+            }
+        }
+        assert(j == vecLength(&vecs[p]));
+        total += j;
+        freeVec(&vecs[p]);
+    }
+    printf("%zu matching records\n", total);
+
+    // an automaton without patterns matches nothing
+    freeAhoCorasick(&ac);
+    if (buildAhoCorasick(&ac, NULL, 0) < 0)
+        die("buildAhoCorasick() failed");
+    memset(seen, 0, sizeof(seen));
+    matchAhoCorasick(&ac, "abcd", 4, &markPattern, seen);
+    assert(seen[0] == 0);
+    freeAhoCorasick(&ac);
+}
+
+/*
+ * Queue stress test: each producer thread enqueues the numbers
+ * 1..QUEUE_ITEMS, tagged with its id, and the consumer checks that it
+ * gets every number from every producer, in order.
+ */
+
+#define QUEUE_PRODUCERS 4
+#define QUEUE_ITEMS 200000
+
+struct Producer {
+    int id;
+    struct MpscQueue *mpsc;
+    struct SpscRing *spsc;
+};
+
+static void *produceMpsc(void *arg)
+{
+    struct Producer *p = (struct Producer *)arg;
+
+    for (uintptr_t i = 1; i <= QUEUE_ITEMS; i++) {
+        if (enqueueMpsc(p->mpsc, (void *)(i * QUEUE_PRODUCERS + p->id)) < 0)
+            die("enqueueMpsc() failed");
+    }
+    return NULL;
+}
+
+static void *produceSpsc(void *arg)
+{
+    struct Producer *p = (struct Producer *)arg;
+
+    for (uintptr_t i = 1; i <= QUEUE_ITEMS; i++) {
+        while (pushSpscRing(p->spsc, (void *)i) < 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void testQueues(void)
+{
+    pthread_t threads[QUEUE_PRODUCERS];
+    struct Producer producers[QUEUE_PRODUCERS];
+    uintptr_t last[QUEUE_PRODUCERS] = { 0 };
+    struct MpscQueue mpsc;
+    void *data;
+    int i;
+
+    printf("testing MpscQueue with %d producers: ", QUEUE_PRODUCERS);
+    initMpscQueue(&mpsc);
+    data = dequeueMpsc(&mpsc);
+    assert(data == NULL);
+
+    for (i = 0; i < QUEUE_PRODUCERS; i++) {
+        producers[i].id = i;
+        producers[i].mpsc = &mpsc;
+        if (pthread_create(&threads[i], NULL, &produceMpsc, &producers[i]))
+            die("pthread_create() failed");
+    }
+
+    for (long received = 0; received < QUEUE_PRODUCERS * QUEUE_ITEMS;) {
+        // let the producers run if they're behind (or mid-enqueue)
+        if ((data = dequeueMpsc(&mpsc)) == NULL) {
+            sched_yield();
+            continue;
+        }
+        uintptr_t id = (uintptr_t)data % QUEUE_PRODUCERS;
+        uintptr_t seq = (uintptr_t)data / QUEUE_PRODUCERS;
+        assert(seq == last[id] + 1);
+        last[id] = seq;
+        received++;
+    }
+
+    for (i = 0; i < QUEUE_PRODUCERS; i++)
+        pthread_join(threads[i], NULL);
+    data = dequeueMpsc(&mpsc);
+    assert(data == NULL);
+    printf("OK\n");
+
+    printf("testing SpscRing: ");
+    struct SpscRing ring;
+    if (initSpscRing(&ring, 100) < 0)
+        die("initSpscRing() failed");
+    data = popSpscRing(&ring);
+    assert(ring.mask == 127 && data == NULL);
+
+    producers[0].spsc = &ring;
+    if (pthread_create(&threads[0], NULL, &produceSpsc, &producers[0]))
+        die("pthread_create() failed");
+
+    for (uintptr_t expected = 1; expected <= QUEUE_ITEMS;) {
+        if ((data = popSpscRing(&ring)) == NULL) {
+            sched_yield();
+            continue;
+        }
+        assert((uintptr_t)data == expected);
+        expected++;
+    }
+
+    pthread_join(threads[0], NULL);
+    data = popSpscRing(&ring);
+    assert(data == NULL);
+
+    // fill it up
+    int pushed = 0;
+    for (i = 0; i <= 127; i++) {
+        if (pushSpscRing(&ring, &ring) == 0)
+            pushed++;
+    }
+    int full = pushSpscRing(&ring, &ring);
+    assert(pushed == 128 && full < 0);
+    freeSpscRing(&ring);
+    printf("OK\n");
+}
+
 int main()
 {
     double a[] = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0 };
@@ -102,5 +739,398 @@ int main()
         printf("]\n");
     }
 
+    // test sortList() on values with duplicates; c[i] and c[i + 3]
+    // compare equal, so a stable sort must keep c[i] first
+    double c[] = { 3.0, 1.0, 2.0, 3.0, 1.0, 2.0, 0.0 };
+    int k = sizeof(c) / sizeof(c[0]);
+
+    printf("testing sortList(): ");
+    for (i = 0; i < k; i++)
+        addFront(&list, c + i);
+    sortList(&list, &orderDouble);
+    traverseList(&list, &printDouble);
+    printf("\n");
+    for (node = list.head; node->next; node = node->next) {
+        if (*(double *)node->data == *(double *)node->next->data)
+            assert((double *)node->data > (double *)node->next->data);
+    }
+
+    printf("testing mergeLists(): ");
+    struct List list2;
+    initList(&list2);
+    for (i = n - 1; i >= 0; i -= 2)
+        addFront(&list2, a + i);
+    mergeLists(&list, &list2, &orderDouble);
+    assert(isEmptyList(&list2));
+    traverseList(&list, &printDouble);
+    printf("\n");
+    removeAllNodes(&list);
+
+    // test parallelTraverseList() with various numbers of threads;
+    // flipSignDouble() only touches its own item, so it is thread-safe
+    double d[100];
+    int nd = sizeof(d) / sizeof(d[0]);
+    for (i = nd - 1; i >= 0; i--) {
+        d[i] = i;
+        addFront(&list, d + i);
+    }
+
+    printf("testing parallelTraverseList(): ");
+    int threadCounts[] = { 1, 2, 3, 8, 200 };
+    for (i = 0; i < (int)(sizeof(threadCounts) / sizeof(threadCounts[0])); i++)
+        parallelTraverseList(&list, &flipSignDouble, threadCounts[i]);
+    for (i = 0; i < nd; i++)
+        assert(d[i] == -i);
+    printf("OK\n");
+    removeAllNodes(&list);
+    parallelTraverseList(&list, &flipSignDouble, 4);
+
+    // test a pooled list, with chunks small enough to need several
+    struct NodePool pool;
+    initNodePool(&pool, 4);
+    initPooledList(&list, &pool);
+
+    printf("testing pooled addBack(): ");
+    for (i = 0; i < n; i++) {
+        if (addBack(&list, a + i) == NULL)
+            die("pooled addBack() failed");
+    }
+    traverseList(&list, &printDouble);
+    printf("\n");
+
+    // popped nodes go on the free list and get reused by addFront()
+    printf("testing pooled popFront() and addFront(): ");
+    popFront(&list);
+    popFront(&list);
+    node = pool.freeList;
+    struct Node *reused = addFront(&list, a);
+    assert(reused == node);
+    traverseList(&list, &printDouble);
+    printf("\n");
+
+    printf("testing pooled removeAllNodes(): ");
+    removeAllNodes(&list);
+    assert(pool.chunks == NULL && pool.freeList == NULL);
+    traverseList(&list, &printDouble);
+    printf("\n");
+
+    // test a list allocating through a counting allocator, first on top
+    // of malloc() and then on top of an arena
+    struct CountingAllocator counter;
+    initCountingAllocator(&counter, NULL);
+    initListWithAllocator(&list, &counter.allocator);
+
+    printf("testing counting allocator: ");
+    for (i = 0; i < n; i++) {
+        if (addBack(&list, a + i) == NULL)
+            die("addBack() with counting allocator failed");
+    }
+    popFront(&list);
+    removeAllNodes(&list);
+    assert(counter.bytes == 0);
+    assert(counter.peakBytes == (size_t)n * sizeof(struct Node));
+    printf("%zu allocs, %zu frees\n", counter.allocs, counter.frees);
+
+    // a node pool has no room for the counting allocator's header
+    initNodePool(&pool, 0);
+    initCountingAllocator(&counter, &pool.allocator);
+    void *tooBig = allocWith(&counter.allocator, sizeof(struct Node));
+    assert(tooBig == NULL && counter.allocator.release == NULL);
+    releaseNodePool(&pool);
+
+    struct Arena arena;
+    initArena(&arena, 64);
+    initCountingAllocator(&counter, &arena.allocator);
+    initListWithAllocator(&list, &counter.allocator);
+
+    printf("testing arena allocator: ");
+    for (i = 0; i < n; i++) {
+        double *p = (double *)allocWith(&counter.allocator, sizeof(double));
+        if (p == NULL || addFront(&list, p) == NULL)
+            die("addFront() with arena allocator failed");
+        *p = a[i];
+    }
+    traverseList(&list, &printDouble);
+    printf("\n");
+    assert(counter.allocs == (size_t)(2 * n) && counter.frees == 0);
+
+    // the nodes and the data go away together
+    releaseArena(&arena);
+    assert(arena.chunks == NULL);
+
+    // test the tail-aware list
+    struct TList tlist, rest;
+    initTList(&tlist);
+    initTList(&rest);
+
+    printf("testing addBackTList(): ");
+    for (i = 0; i < n; i++) {
+        node = addBackTList(&tlist, a + i);
+        if (node == NULL)
+            die("addBackTList() failed");
+    }
+    assert(tlist.tail == node && lengthTList(&tlist) == n);
+    traverseList(&tlist.list, &printDouble);
+    printf("\n");
+
+    printf("testing splitTList(): ");
+    x = 4.0;
+    node = findNode(&tlist.list, &x, &compareDouble);
+    splitTList(&tlist, node, 4, &rest);
+    assert(tlist.tail == node && lengthTList(&tlist) == 4);
+    assert(lengthTList(&rest) == n - 4);
+    traverseList(&tlist.list, &printDouble);
+    printf("| ");
+    traverseList(&rest.list, &printDouble);
+    printf("\n");
+
+    printf("testing concatTList(): ");
+    reverseTList(&rest);
+    concatTList(&rest, &tlist);
+    assert(isEmptyList(&tlist.list) && tlist.tail == NULL);
+    assert(lengthTList(&rest) == n && *(double *)rest.tail->data == 4.0);
+    traverseList(&rest.list, &printDouble);
+    printf("\n");
+
+    printf("testing sortTList() and mergeTLists(): ");
+    for (i = 0; i < k; i++)
+        addBackTList(&tlist, c + i);
+    sortTList(&tlist, &orderDouble);
+    assert(tlist.tail->data == c + 3);
+    sortTList(&rest, &orderDouble);
+    mergeTLists(&tlist, &rest, &orderDouble);
+    assert(lengthTList(&tlist) == n + k && tlist.tail->data == a + n - 1);
+    traverseList(&tlist.list, &printDouble);
+    printf("\n");
+    concatTList(&rest, &tlist);
+
+    printf("testing popFrontTList(): ");
+    while (popFrontTList(&rest) != NULL)
+        ;
+    assert(rest.tail == NULL && lengthTList(&rest) == 0);
+    addBackTList(&rest, a);
+    traverseList(&rest.list, &printDouble);
+    printf("\n");
+    removeAllTList(&rest);
+
+    // test the intrusive list
+    struct Elem elems[sizeof(a) / sizeof(a[0])];
+    struct IList ilist;
+    initIList(&ilist);
+
+    printf("testing addAfterLink(): ");
+    struct Link *link = NULL;
+    for (i = 0; i < n; i++) {
+        elems[i].value = a[i];
+        addAfterLink(&ilist, link, &elems[i].link);
+        link = &elems[i].link;
+    }
+    assert(ilist.tail == link && ilist.length == n);
+    traverseIList(&ilist, &printElem);
+    printf("\n");
+
+    printf("testing splitIList() and concatIList(): ");
+    struct IList irest;
+    initIList(&irest);
+    splitIList(&ilist, &elems[2].link, 3, &irest);
+    assert(ilist.length == 3 && irest.length == n - 3);
+    assert(ilist.tail == &elems[2].link && irest.tail == &elems[n - 1].link);
+    concatIList(&ilist, &irest);
+    assert(ilist.tail == &elems[n - 1].link && ilist.length == n);
+    assert(isEmptyIList(&irest));
+    traverseIList(&ilist, &printElem);
+    printf("\n");
+
+    printf("testing findLink(): ");
+    x = 3.5;
+    assert(findLink(&ilist, &x, &compareElem) == NULL);
+    x = 4.0;
+    assert(findLink(&ilist, &x, &compareElem) == &elems[3].link);
+    printf("OK\n");
+
+    printf("testing reverseIList(): ");
+    reverseIList(&ilist);
+    traverseIList(&ilist, &printElem);
+    printf("\n");
+
+    printf("testing popFrontLink() and addFrontLink(): ");
+    link = popFrontLink(&ilist);
+    assert(containerOf(link, struct Elem, link) == &elems[n - 1]);
+    popFrontLink(&ilist);
+    addFrontLink(&ilist, link);
+    traverseIList(&ilist, &printElem);
+    printf("\n");
+
+    while (popFrontLink(&ilist))
+        ;
+    assert(isEmptyIList(&ilist) && ilist.tail == NULL && ilist.length == 0);
+
+    printf("testing addBackLink(): ");
+    for (i = 0; i < n; i++)
+        addBackLink(&ilist, &elems[i].link);
+    assert(ilist.tail == &elems[n - 1].link && ilist.length == n);
+    traverseIList(&ilist, &printElem);
+    printf("\n");
+
+    printf("testing sortIList() and mergeILists(): ");
+    reverseIList(&ilist);
+    splitIList(&ilist, &elems[5].link, 4, &irest);
+    sortIList(&ilist, &orderElem);
+    sortIList(&irest, &orderElem);
+    assert(ilist.tail == &elems[8].link && irest.tail == &elems[4].link);
+    mergeILists(&irest, &ilist, &orderElem);
+    assert(irest.tail == &elems[8].link && irest.length == n);
+    traverseIList(&irest, &printElem);
+    printf("\n");
+
+    // test the unrolled list with enough items to fill several blocks
+    double b[40];
+    int m = sizeof(b) / sizeof(b[0]);
+    struct UList ulist;
+    struct UPos pos = { NULL, 0 };
+    initUList(&ulist);
+
+    printf("testing addAfterUList(): ");
+    for (i = 0; i < m; i++) {
+        b[i] = i;
+        pos = addAfterUList(&ulist, pos, b + i);
+        if (pos.block == NULL)
+            die("addAfterUList() failed");
+    }
+    traverseUList(&ulist, &printDouble);
+    printf("\n");
+
+    // insert into the middle of a full block so that it gets split
+    printf("testing addAfterUList() into a full block: ");
+    x = 5.0;
+    pos = findUList(&ulist, &x, &compareDouble);
+    assert(pos.block && pos.block->count == UBLOCK_CAP);
+    pos = addAfterUList(&ulist, pos, a);
+    assert(pos.block && dataAtUPos(pos) == a);
+    traverseUList(&ulist, &printDouble);
+    printf("\n");
+
+    printf("testing findUList(): ");
+    x = 40.0;
+    pos = findUList(&ulist, &x, &compareDouble);
+    assert(pos.block == NULL);
+    x = 39.0;
+    pos = findUList(&ulist, &x, &compareDouble);
+    assert(pos.block && dataAtUPos(pos) == b + 39);
+    printf("OK\n");
+
+    printf("testing reverseUList(): ");
+    reverseUList(&ulist);
+    traverseUList(&ulist, &printDouble);
+    printf("\n");
+
+    printf("testing popFrontUList() and addFrontUList(): ");
+    for (i = 0; i < 20; i++)
+        popFrontUList(&ulist);
+    pos = addFrontUList(&ulist, a + 1);
+    assert(pos.block == ulist.head && pos.index == 0);
+    traverseUList(&ulist, &printDouble);
+    printf("\n");
+
+    printf("testing removeAllUList(): ");
+    removeAllUList(&ulist);
+    traverseUList(&ulist, &printDouble);
+    printf("\n");
+    assert(isEmptyUList(&ulist));
+
+    // test a vector of pointers, growing it past its initial capacity
+    struct Vec vec;
+    initVec(&vec);
+
+    printf("testing pushVec(): ");
+    for (i = 0; i < m; i++) {
+        if (pushVec(&vec, b + i) < 0)
+            die("pushVec() failed");
+    }
+    traverseVec(&vec, &printDouble);
+    printf("\n");
+
+    printf("testing findVec(): ");
+    x = 40.0;
+    assert(findVec(&vec, &x, &compareDouble) == VEC_NOT_FOUND);
+    x = 17.0;
+    assert(findVec(&vec, &x, &compareDouble) == 17);
+    assert(vecAt(&vec, 17) == b + 17);
+    printf("OK\n");
+
+    printf("testing reverseVec(): ");
+    reverseVec(&vec);
+    traverseVec(&vec, &printDouble);
+    printf("\n");
+    freeVec(&vec);
+
+    // test a vector of records, which holds copies of the values
+    initRecVec(&vec, sizeof(double));
+    if (reserveVec(&vec, n) < 0)
+        die("reserveVec() failed");
+    char *items = vec.items;
+
+    printf("testing pushRecVec(): ");
+    for (i = 0; i < n; i++) {
+        if (pushRecVec(&vec, a + i) == NULL)
+            die("pushRecVec() failed");
+    }
+    assert(vec.items == items && vecAt(&vec, 0) != a);
+    traverseVec(&vec, &flipSignDouble);
+    traverseVec(&vec, &printDouble);
+    printf("\n");
+
+    printf("testing reverseVec() on records: ");
+    reverseVec(&vec);
+    traverseVec(&vec, &printDouble);
+    printf("\n");
+
+    printf("testing truncateVec() and appendRecsVec(): ");
+    truncateVec(&vec, 3);
+    truncateVec(&vec, 5);
+    if (appendRecsVec(&vec, a, 5) < 0 || appendRecsVec(&vec, a, 0) < 0)
+        die("appendRecsVec() failed");
+    assert(vecLength(&vec) == 8);
+    traverseVec(&vec, &printDouble);
+    printf("\n");
+    freeVec(&vec);
+
+    // test the typed list
+    struct DoubleList dlist;
+    struct DoubleNode *dnode = NULL;
+    initDoubleList(&dlist);
+
+    printf("testing addDoubleAfter(): ");
+    for (i = 0; i < n; i++) {
+        dnode = addDoubleAfter(&dlist, dnode, a[i]);
+        if (dnode == NULL)
+            die("addDoubleAfter() failed");
+    }
+    traverseDoubleList(&dlist, &printTypedDouble);
+    printf("\n");
+
+    printf("testing findDoubleNode(): ");
+    x = 3.5;
+    assert(findDoubleNode(&dlist, &x, &compareTypedDouble) == NULL);
+    x = 6.0;
+    dnode = findDoubleNode(&dlist, &x, &compareTypedDouble);
+    assert(dnode != NULL && dnode->data == x && &dnode->data != a + 5);
+    printf("OK\n");
+
+    printf("testing reverseDoubleList() and popDoubleFront(): ");
+    reverseDoubleList(&dlist);
+    addDoubleFront(&dlist, 0.0);
+    while (popDoubleFront(&dlist, &x))
+        printf("%.1f ", x);
+    printf("\n");
+    assert(isEmptyDoubleList(&dlist));
+
+    testHash();
+    testSkipList();
+    testTrigram();
+    testScan();
+    testAhoCorasick();
+    testQueues();
+
     return 0;
 }
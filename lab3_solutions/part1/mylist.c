@@ -6,9 +6,85 @@
 
 #include "mylist.h"
 
+static void *poolAlloc(void *ctx, size_t size)
+{
+    struct NodePool *pool = (struct NodePool *)ctx;
+
+    // the pool only has room for nodes
+    if (size > sizeof(struct Node))
+        return NULL;
+
+    // reuse a node released by popFront() if there is one
+    if (pool->freeList) {
+        struct Node *node = pool->freeList;
+        pool->freeList = node->next;
+        return node;
+    }
+
+    // start a new chunk when the current one is used up
+    if (pool->chunks == NULL || pool->used == pool->chunkSize) {
+        struct NodeChunk *chunk = (struct NodeChunk *)malloc(
+            sizeof(struct NodeChunk) + pool->chunkSize * sizeof(struct Node));
+        if (chunk == NULL)
+            return NULL;
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->used = 0;
+    }
+
+    return &pool->chunks->nodes[pool->used++];
+}
+
+static void poolFree(void *ctx, void *ptr)
+{
+    struct NodePool *pool = (struct NodePool *)ctx;
+    struct Node *node = (struct Node *)ptr;
+
+    node->next = pool->freeList;
+    pool->freeList = node;
+}
+
+static void poolRelease(void *ctx)
+{
+    releaseNodePool((struct NodePool *)ctx);
+}
+
+void initNodePool(struct NodePool *pool, size_t chunkSize)
+{
+    pool->allocator.alloc = &poolAlloc;
+    pool->allocator.free = &poolFree;
+    pool->allocator.release = &poolRelease;
+    pool->allocator.ctx = pool;
+    pool->chunks = NULL;
+    pool->freeList = NULL;
+    pool->chunkSize = chunkSize ? chunkSize : NODE_POOL_DEFAULT_CHUNK;
+    pool->used = 0;
+}
+
+void releaseNodePool(struct NodePool *pool)
+{
+    struct NodeChunk *chunk = pool->chunks;
+    while (chunk) {
+        struct NodeChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    initNodePool(pool, pool->chunkSize);
+}
+
+static struct Node *allocNode(struct List *list)
+{
+    return (struct Node *)allocWith(list->allocator, sizeof(struct Node));
+}
+
+static void freeNode(struct List *list, struct Node *node)
+{
+    freeWith(list->allocator, node);
+}
+
 struct Node *addFront(struct List *list, void *data)
 {
-    struct Node *node = (struct Node *)malloc(sizeof(struct Node));
+    struct Node *node = allocNode(list);
     if (node == NULL)
         return NULL;
 
@@ -60,12 +136,20 @@ void *popFront(struct List *list)
     struct Node *oldHead = list->head;
     list->head = oldHead->next;
     void *data = oldHead->data;
-    free(oldHead);
+    freeNode(list, oldHead);
     return data;
 }
 
 void removeAllNodes(struct List *list)
 {
+    // an allocator that can release everything at once (such as a
+    // pool) belongs to this list alone, so drop its memory wholesale
+    if (list->allocator && list->allocator->release) {
+        list->head = NULL;
+        list->allocator->release(list->allocator->ctx);
+        return;
+    }
+
     while (!isEmptyList(list))
         popFront(list);
 }
@@ -76,7 +160,7 @@ struct Node *addAfter(struct List *list,
     if (prevNode == NULL)
         return addFront(list, data);
 
-    struct Node *node = (struct Node *)malloc(sizeof(struct Node));
+    struct Node *node = allocNode(list);
     if (node == NULL)
         return NULL;
 
@@ -105,7 +189,7 @@ void reverseList(struct List *list)
 struct Node *addBack(struct List *list, void *data)
 {
     // make the new node that will go to the end of list
-    struct Node *node = (struct Node *)malloc(sizeof(struct Node));
+    struct Node *node = allocNode(list);
     if (node == NULL)
         return NULL;
     node->data = data;
@@ -126,3 +210,422 @@ struct Node *addBack(struct List *list, void *data)
     end->next = node;
     return node;
 }
+
+/*
+ * Bottom-up merge sort of the chain of nodes starting at 'head'.
+ *
+ * Each pass merges neighboring sorted runs of length 'k' into runs of
+ * length 2k, taking from the left run on ties to keep the sort stable.
+ * We're done when a pass performs only one merge.
+ *
+ * Returns the new first node and sets '*tailp' to the new last node.
+ */
+static struct Node *sortNodes(struct Node *head,
+    int (*compar)(const void *, const void *), struct Node **tailp)
+{
+    struct Node *tail = NULL;
+    size_t k = 1;
+
+    if (head == NULL) {
+        *tailp = NULL;
+        return NULL;
+    }
+
+    for (;;) {
+        struct Node *p = head;
+        size_t merges = 0;
+        head = tail = NULL;
+
+        while (p) {
+            merges++;
+
+            // the left run starts at p, the right run at q
+            struct Node *q = p;
+            size_t psize = 0, qsize = k;
+            while (psize < k && q) {
+                psize++;
+                q = q->next;
+            }
+
+            while (psize > 0 || (qsize > 0 && q)) {
+                struct Node *e;
+                if (psize == 0 || (qsize > 0 && q && compar(q->data, p->data) < 0)) {
+                    e = q;
+                    q = q->next;
+                    qsize--;
+                } else {
+                    e = p;
+                    p = p->next;
+                    psize--;
+                }
+
+                if (tail)
+                    tail->next = e;
+                else
+                    head = e;
+                tail = e;
+            }
+
+            p = q;
+        }
+
+        tail->next = NULL;
+        if (merges <= 1) {
+            *tailp = tail;
+            return head;
+        }
+        k *= 2;
+    }
+}
+
+/*
+ * Merge the sorted chains starting at 'a' and 'b', taking from 'a' on
+ * ties, and return the new first node.
+ */
+static struct Node *mergeNodes(struct Node *a, struct Node *b,
+    int (*compar)(const void *, const void *))
+{
+    struct Node head;
+    struct Node *tail = &head;
+
+    while (a && b) {
+        if (compar(b->data, a->data) < 0) {
+            tail->next = b;
+            b = b->next;
+        } else {
+            tail->next = a;
+            a = a->next;
+        }
+        tail = tail->next;
+    }
+
+    tail->next = a ? a : b;
+    return head.next;
+}
+
+void sortList(struct List *list, int (*compar)(const void *, const void *))
+{
+    struct Node *tail;
+    list->head = sortNodes(list->head, compar, &tail);
+}
+
+void mergeLists(struct List *dest, struct List *src,
+    int (*compar)(const void *, const void *))
+{
+    dest->head = mergeNodes(dest->head, src->head, compar);
+    src->head = NULL;
+}
+
+struct Node *addFrontTList(struct TList *tlist, void *data)
+{
+    struct Node *node = addFront(&tlist->list, data);
+    if (node == NULL)
+        return NULL;
+
+    if (tlist->tail == NULL)
+        tlist->tail = node;
+    tlist->length++;
+    return node;
+}
+
+struct Node *addBackTList(struct TList *tlist, void *data)
+{
+    return addAfterTList(tlist, tlist->tail, data);
+}
+
+struct Node *addAfterTList(struct TList *tlist,
+    struct Node *prevNode, void *data)
+{
+    if (prevNode == NULL)
+        return addFrontTList(tlist, data);
+
+    struct Node *node = addAfter(&tlist->list, prevNode, data);
+    if (node == NULL)
+        return NULL;
+
+    if (prevNode == tlist->tail)
+        tlist->tail = node;
+    tlist->length++;
+    return node;
+}
+
+void *popFrontTList(struct TList *tlist)
+{
+    if (isEmptyList(&tlist->list))
+        return NULL;
+
+    void *data = popFront(&tlist->list);
+    if (--tlist->length == 0)
+        tlist->tail = NULL;
+    return data;
+}
+
+void reverseTList(struct TList *tlist)
+{
+    tlist->tail = tlist->list.head;
+    reverseList(&tlist->list);
+}
+
+void removeAllTList(struct TList *tlist)
+{
+    removeAllNodes(&tlist->list);
+    tlist->tail = NULL;
+    tlist->length = 0;
+}
+
+void concatTList(struct TList *dest, struct TList *src)
+{
+    if (src->length == 0)
+        return;
+
+    if (dest->tail)
+        dest->tail->next = src->list.head;
+    else
+        dest->list.head = src->list.head;
+
+    dest->tail = src->tail;
+    dest->length += src->length;
+
+    src->list.head = NULL;
+    src->tail = NULL;
+    src->length = 0;
+}
+
+void splitTList(struct TList *tlist, struct Node *node, size_t position,
+    struct TList *rest)
+{
+    if (node->next == NULL)
+        return;
+
+    rest->list.head = node->next;
+    rest->tail = tlist->tail;
+    rest->length = tlist->length - position;
+
+    node->next = NULL;
+    tlist->tail = node;
+    tlist->length = position;
+}
+
+void sortTList(struct TList *tlist,
+    int (*compar)(const void *, const void *))
+{
+    tlist->list.head = sortNodes(tlist->list.head, compar, &tlist->tail);
+}
+
+void mergeTLists(struct TList *dest, struct TList *src,
+    int (*compar)(const void *, const void *))
+{
+    dest->list.head = mergeNodes(dest->list.head, src->list.head, compar);
+
+    // whichever old tail ended up last is still followed by nothing
+    if (dest->tail == NULL || dest->tail->next)
+        dest->tail = src->tail;
+    dest->length += src->length;
+
+    src->list.head = NULL;
+    src->tail = NULL;
+    src->length = 0;
+}
+
+void addFrontLink(struct IList *list, struct Link *link)
+{
+    link->next = list->head;
+    list->head = link;
+    if (list->tail == NULL)
+        list->tail = link;
+    list->length++;
+}
+
+void addAfterLink(struct IList *list, struct Link *prevLink,
+    struct Link *link)
+{
+    if (prevLink == NULL) {
+        addFrontLink(list, link);
+        return;
+    }
+
+    link->next = prevLink->next;
+    prevLink->next = link;
+    if (prevLink == list->tail)
+        list->tail = link;
+    list->length++;
+}
+
+void addBackLink(struct IList *list, struct Link *link)
+{
+    addAfterLink(list, list->tail, link);
+}
+
+void concatIList(struct IList *dest, struct IList *src)
+{
+    if (src->length == 0)
+        return;
+
+    if (dest->tail)
+        dest->tail->next = src->head;
+    else
+        dest->head = src->head;
+
+    dest->tail = src->tail;
+    dest->length += src->length;
+    initIList(src);
+}
+
+void splitIList(struct IList *list, struct Link *link, size_t position,
+    struct IList *rest)
+{
+    if (link->next == NULL)
+        return;
+
+    rest->head = link->next;
+    rest->tail = list->tail;
+    rest->length = list->length - position;
+
+    link->next = NULL;
+    list->tail = link;
+    list->length = position;
+}
+
+struct Link *popFrontLink(struct IList *list)
+{
+    struct Link *link = list->head;
+    if (link) {
+        list->head = link->next;
+        if (--list->length == 0)
+            list->tail = NULL;
+    }
+    return link;
+}
+
+void traverseIList(struct IList *list, void (*f)(struct Link *))
+{
+    struct Link *link = list->head;
+    while (link) {
+        // f() may unlink or free the element, so read 'next' first
+        struct Link *next = link->next;
+        f(link);
+        link = next;
+    }
+}
+
+struct Link *findLink(struct IList *list, const void *dataSought,
+    int (*compar)(const void *, const struct Link *))
+{
+    struct Link *link = list->head;
+    while (link) {
+        if (compar(dataSought, link) == 0)
+            return link;
+        link = link->next;
+    }
+    return NULL;
+}
+
+void reverseIList(struct IList *list)
+{
+    list->tail = list->head;
+
+    struct Link *prv = NULL;
+    struct Link *cur = list->head;
+    struct Link *nxt;
+
+    while (cur) {
+        nxt = cur->next;
+        cur->next = prv;
+        prv = cur;
+        cur = nxt;
+    }
+
+    list->head = prv;
+}
+
+// The intrusive counterparts of sortNodes() and mergeNodes().
+
+static struct Link *sortLinks(struct Link *head,
+    int (*compar)(const struct Link *, const struct Link *),
+    struct Link **tailp)
+{
+    struct Link *tail = NULL;
+    size_t k = 1;
+
+    if (head == NULL) {
+        *tailp = NULL;
+        return NULL;
+    }
+
+    for (;;) {
+        struct Link *p = head;
+        size_t merges = 0;
+        head = tail = NULL;
+
+        while (p) {
+            merges++;
+
+            struct Link *q = p;
+            size_t psize = 0, qsize = k;
+            while (psize < k && q) {
+                psize++;
+                q = q->next;
+            }
+
+            while (psize > 0 || (qsize > 0 && q)) {
+                struct Link *e;
+                if (psize == 0 || (qsize > 0 && q && compar(q, p) < 0)) {
+                    e = q;
+                    q = q->next;
+                    qsize--;
+                } else {
+                    e = p;
+                    p = p->next;
+                    psize--;
+                }
+
+                if (tail)
+                    tail->next = e;
+                else
+                    head = e;
+                tail = e;
+            }
+
+            p = q;
+        }
+
+        tail->next = NULL;
+        if (merges <= 1) {
+            *tailp = tail;
+            return head;
+        }
+        k *= 2;
+    }
+}
+
+void sortIList(struct IList *list,
+    int (*compar)(const struct Link *, const struct Link *))
+{
+    list->head = sortLinks(list->head, compar, &list->tail);
+}
+
+void mergeILists(struct IList *dest, struct IList *src,
+    int (*compar)(const struct Link *, const struct Link *))
+{
+    struct Link head;
+    struct Link *tail = &head;
+    struct Link *a = dest->head, *b = src->head;
+
+    while (a && b) {
+        if (compar(b, a) < 0) {
+            tail->next = b;
+            b = b->next;
+        } else {
+            tail->next = a;
+            a = a->next;
+        }
+        tail = tail->next;
+    }
+    tail->next = a ? a : b;
+    dest->head = head.next;
+
+    if (dest->tail == NULL || dest->tail->next)
+        dest->tail = src->tail;
+    dest->length += src->length;
+    initIList(src);
+}
@@ -1,6 +1,10 @@
 #ifndef _MYLIST_H_
 #define _MYLIST_H_
 
+#include <stddef.h>
+
+#include "myalloc.h"
+
 /*
  * A node in a linked list.
  */
@@ -9,12 +13,48 @@ struct Node {
     struct Node *next;
 };
 
+/*
+ * A chunk of nodes allocated in one piece by a NodePool.
+ */
+struct NodeChunk {
+    struct NodeChunk *next;
+    struct Node nodes[];
+};
+
+/*
+ * A slab allocator for the nodes of a single list.
+ *
+ * Nodes are carved out of chunks holding 'chunkSize' nodes each, so
+ * creating a node is usually just a pointer bump.  Nodes released by
+ * popFront() are kept on 'freeList' and handed out again before the
+ * current chunk is touched.
+ *
+ * 'chunks' points to the most recently allocated chunk, and 'used' is
+ * the number of nodes already handed out from it.
+ *
+ * 'allocator' is the pool's struct Allocator interface.  It can only
+ * allocate objects of up to sizeof(struct Node) bytes, failing for
+ * anything bigger, and its 'release' callback is releaseNodePool().
+ */
+struct NodePool {
+    struct Allocator allocator;
+    struct NodeChunk *chunks;
+    struct Node *freeList;
+    size_t chunkSize;
+    size_t used;
+};
+
+#define NODE_POOL_DEFAULT_CHUNK 1024
+
 /*
  * A linked list.
  * 'head' points to the first node in the list.
+ * 'allocator' is used to allocate and free nodes; if it is NULL, nodes
+ * are allocated with malloc().
  */
 struct List {
     struct Node *head;
+    struct Allocator *allocator;
 };
 
 /*
@@ -23,6 +63,41 @@ struct List {
 static inline void initList(struct List *list)
 {
     list->head = 0;
+    list->allocator = 0;
+}
+
+/*
+ * Initialize an empty list whose nodes are allocated from 'allocator'
+ * (see myalloc.h).
+ */
+static inline void initListWithAllocator(struct List *list,
+    struct Allocator *allocator)
+{
+    list->head = 0;
+    list->allocator = allocator;
+}
+
+/*
+ * Initialize an empty node pool whose chunks hold 'chunkSize' nodes.
+ * If 'chunkSize' is 0, NODE_POOL_DEFAULT_CHUNK is used.
+ */
+void initNodePool(struct NodePool *pool, size_t chunkSize);
+
+/*
+ * Free all chunks in the pool, which invalidates every node that was
+ * allocated from it.  The pool is left empty and can be used again.
+ */
+void releaseNodePool(struct NodePool *pool);
+
+/*
+ * Initialize an empty list whose nodes are allocated from 'pool'.
+ *
+ * A pool must back exactly one list: removeAllNodes() on the list
+ * releases the whole pool at once instead of freeing node by node.
+ */
+static inline void initPooledList(struct List *list, struct NodePool *pool)
+{
+    initListWithAllocator(list, &pool->allocator);
 }
 
 /*
@@ -102,6 +177,9 @@ void *popFront(struct List *list);
 /*
  * Remove all nodes from the list, deallocating the memory for the
  * nodes.  You can implement this function using popFront().
+ *
+ * If the list's allocator can release everything at once (as a
+ * NodePool can), that is done instead of freeing node by node.
  */
 void removeAllNodes(struct List *list);
 
@@ -144,4 +222,296 @@ struct Node *addAfter(struct List *list,
  */
 void reverseList(struct List *list);
 
+/*
+ * Sort the list in ascending order according to 'compar', which
+ * returns a negative number, 0, or a positive number if the data
+ * pointed to by its first parameter is less than, equal to, or greater
+ * than the data pointed to by its second parameter (just like the
+ * comparison function for qsort()).
+ *
+ * The sort is stable: nodes with equal data keep their relative
+ * order.  It is a bottom-up merge sort that runs in O(n log n) time
+ * and, like reverseList(), only relinks the existing nodes, so it does
+ * not allocate any memory.
+ */
+void sortList(struct List *list, int (*compar)(const void *, const void *));
+
+/*
+ * Merge 'src' into 'dest', both of which must already be sorted
+ * according to 'compar' (see sortList()), leaving 'src' empty.  When
+ * data compare equal, nodes from 'dest' come first.
+ *
+ * Both lists must allocate their nodes with the same allocator.
+ */
+void mergeLists(struct List *dest, struct List *src,
+    int (*compar)(const void *, const void *));
+
+/*
+ * Traverse the list like traverseList(), but call f() from 'nthreads'
+ * threads at once, each handling its own run of consecutive nodes.
+ *
+ * f() must be thread-safe: it will be called concurrently on different
+ * data items, in no particular order.  Updating only the item it is
+ * given (as flipSignDouble() does) is fine; updating anything shared
+ * requires synchronization.  The list itself must not be modified
+ * until this function returns, which it does after all calls to f()
+ * have returned.
+ *
+ * The list is split with one pass over it that records a bounded
+ * number of evenly spaced nodes, so the runs are roughly equal in
+ * length.  If 'nthreads' is less than 2, or threads cannot be created,
+ * the remaining work is done in the calling thread.
+ *
+ * This function is defined in mylistpar.c; programs that use it must
+ * be linked with -pthread.
+ */
+void parallelTraverseList(struct List *list, void (*f)(void *), int nthreads);
+
+/*
+ * Tail-aware lists
+ *
+ * A TList is a List that also keeps track of its last node and its
+ * length, so that appending, asking for the length, concatenating and
+ * splitting all take constant time.  The embedded 'list' can be passed
+ * to any function above that does not add or remove nodes, e.g.
+ * traverseList(&tlist.list, f) or findNode(&tlist.list, ...).
+ */
+
+/*
+ * A linked list with a tail pointer and a node count.
+ * 'tail' points to the last node in the list (NULL if empty).
+ */
+struct TList {
+    struct List list;
+    struct Node *tail;
+    size_t length;
+};
+
+/*
+ * Initialize an empty tail-aware list.
+ */
+static inline void initTList(struct TList *tlist)
+{
+    initList(&tlist->list);
+    tlist->tail = 0;
+    tlist->length = 0;
+}
+
+/*
+ * Initialize an empty tail-aware list whose nodes are allocated from
+ * 'pool' (see initPooledList()).
+ */
+static inline void initPooledTList(struct TList *tlist, struct NodePool *pool)
+{
+    initPooledList(&tlist->list, pool);
+    tlist->tail = 0;
+    tlist->length = 0;
+}
+
+/*
+ * Initialize an empty tail-aware list whose nodes are allocated from
+ * 'allocator'.
+ */
+static inline void initTListWithAllocator(struct TList *tlist,
+    struct Allocator *allocator)
+{
+    initListWithAllocator(&tlist->list, allocator);
+    tlist->tail = 0;
+    tlist->length = 0;
+}
+
+/*
+ * Returns the number of nodes in the list.
+ */
+static inline size_t lengthTList(struct TList *tlist)
+{
+    return tlist->length;
+}
+
+/*
+ * These behave like addFront(), addBack(), addAfter() and popFront(),
+ * but addBackTList() takes O(1) time.
+ */
+struct Node *addFrontTList(struct TList *tlist, void *data);
+struct Node *addBackTList(struct TList *tlist, void *data);
+struct Node *addAfterTList(struct TList *tlist,
+    struct Node *prevNode, void *data);
+void *popFrontTList(struct TList *tlist);
+
+/*
+ * Reverse the list.  Like reverseList(), it does not allocate.
+ */
+void reverseTList(struct TList *tlist);
+
+/*
+ * Remove all nodes from the list, deallocating the memory for the
+ * nodes.
+ */
+void removeAllTList(struct TList *tlist);
+
+/*
+ * Move all nodes of 'src' to the end of 'dest', leaving 'src' empty.
+ * No nodes are allocated or freed.
+ *
+ * Both lists must allocate their nodes with the same allocator.
+ */
+void concatTList(struct TList *dest, struct TList *src);
+
+/*
+ * Split the list right after 'node': 'node' becomes the last node of
+ * 'tlist', and the nodes that followed it are moved into 'rest', which
+ * must be empty and allocate its nodes the same way as 'tlist'.
+ *
+ * 'position' is the 1-based position of 'node' in the list (i.e., the
+ * number of nodes that stay in 'tlist'); passing it in is what lets
+ * this function keep both lengths up to date in O(1) time.
+ */
+void splitTList(struct TList *tlist, struct Node *node, size_t position,
+    struct TList *rest);
+
+/*
+ * These behave like sortList() and mergeLists(), keeping 'tail' and
+ * 'length' up to date.
+ */
+void sortTList(struct TList *tlist,
+    int (*compar)(const void *, const void *));
+void mergeTLists(struct TList *dest, struct TList *src,
+    int (*compar)(const void *, const void *));
+
+/*
+ * Intrusive lists
+ *
+ * An intrusive list does not allocate nodes of its own.  Instead, each
+ * element embeds a struct Link, and the list strings the links
+ * together.  Adding an element never fails, and the element and its
+ * link share one allocation and (usually) one cache line.
+ *
+ * Use containerOf() to get from a link back to the element, e.g.:
+
+      struct Rec {
+          int value;
+          struct Link link;
+      };
+
+      struct Rec *rec = containerOf(link, struct Rec, link);
+
+ * None of the functions below manage the lifetime of the elements.
+ */
+
+/*
+ * A link embedded in an element of an intrusive list.
+ */
+struct Link {
+    struct Link *next;
+};
+
+/*
+ * An intrusive linked list.
+ * 'head' points to the link of the first element in the list, 'tail'
+ * to the link of the last one, and 'length' is the number of elements,
+ * so that appending and counting take constant time.
+ */
+struct IList {
+    struct Link *head;
+    struct Link *tail;
+    size_t length;
+};
+
+/*
+ * Given a pointer to the 'member' field of a structure of type 'type',
+ * evaluate to a pointer to the structure itself.
+ */
+#define containerOf(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+/*
+ * Initialize an empty intrusive list.
+ */
+static inline void initIList(struct IList *list)
+{
+    list->head = 0;
+    list->tail = 0;
+    list->length = 0;
+}
+
+/*
+ * Returns 1 if the intrusive list is empty, 0 otherwise.
+ */
+static inline int isEmptyIList(struct IList *list)
+{
+    return (list->head == 0);
+}
+
+/*
+ * Add the element containing 'link' to the front of the list.
+ */
+void addFrontLink(struct IList *list, struct Link *link);
+
+/*
+ * Add the element containing 'link' right after 'prevLink'.  If
+ * 'prevLink' is NULL, this function is equivalent to addFrontLink().
+ */
+void addAfterLink(struct IList *list, struct Link *prevLink,
+    struct Link *link);
+
+/*
+ * Add the element containing 'link' to the end of the list, in O(1)
+ * time.
+ */
+void addBackLink(struct IList *list, struct Link *link);
+
+/*
+ * Move all elements of 'src' to the end of 'dest', leaving 'src' empty.
+ */
+void concatIList(struct IList *dest, struct IList *src);
+
+/*
+ * Split the list right after 'link', moving the elements that followed
+ * it into 'rest', which must be empty.  'position' is the 1-based
+ * position of 'link' in the list; see splitTList().
+ */
+void splitIList(struct IList *list, struct Link *link, size_t position,
+    struct IList *rest);
+
+/*
+ * Remove the first element from the list and return its link.
+ * Returns NULL if the list is empty.
+ */
+struct Link *popFrontLink(struct IList *list);
+
+/*
+ * Traverse the list, calling f() with the link of each element.
+ */
+void traverseIList(struct IList *list, void (*f)(struct Link *));
+
+/*
+ * Traverse the list, comparing 'dataSought' with the link of each
+ * element using 'compar' function, which returns 0 on a match.
+ *
+ * Returns the link of the first matching element, NULL if not found.
+ */
+struct Link *findLink(struct IList *list, const void *dataSought,
+    int (*compar)(const void *, const struct Link *));
+
+/*
+ * Reverse the intrusive list by manipulating links.
+ */
+void reverseIList(struct IList *list);
+
+/*
+ * Stable, allocation-free merge sort of the intrusive list; 'compar'
+ * is given the links of two elements and orders them like the
+ * comparison function for qsort().  See sortList().
+ */
+void sortIList(struct IList *list,
+    int (*compar)(const struct Link *, const struct Link *));
+
+/*
+ * Merge 'src' into 'dest', both sorted according to 'compar', leaving
+ * 'src' empty.  When elements compare equal, those from 'dest' come
+ * first.
+ */
+void mergeILists(struct IList *dest, struct IList *src,
+    int (*compar)(const struct Link *, const struct Link *));
+
 #endif /* #ifndef _MYLIST_H_ */
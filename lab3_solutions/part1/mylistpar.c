@@ -0,0 +1,114 @@
+/*
+ * mylistpar.c
+ *
+ *  parallelTraverseList() lives in its own object file so that programs
+ *  that don't use it don't need to be linked with -pthread.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "mylist.h"
+
+// Number of split points recorded per thread.  Recording more than one
+// lets us even out the runs when the list length isn't a multiple of
+// the split point spacing.
+#define SPLITS_PER_THREAD 4
+
+/*
+ * A run of consecutive nodes, from 'first' up to but not including
+ * 'end' (NULL for the end of the list).
+ */
+struct Run {
+    struct Node *first;
+    struct Node *end;
+    void (*f)(void *);
+};
+
+static void *traverseRun(void *arg)
+{
+    struct Run *run = (struct Run *)arg;
+
+    for (struct Node *node = run->first; node != run->end; node = node->next)
+        run->f(node->data);
+    return NULL;
+}
+
+void parallelTraverseList(struct List *list, void (*f)(void *), int nthreads)
+{
+    if (nthreads < 2 || isEmptyList(list)) {
+        traverseList(list, f);
+        return;
+    }
+
+    size_t maxSplits = (size_t)nthreads * SPLITS_PER_THREAD;
+    struct Node **splits = (struct Node **)malloc(maxSplits * sizeof(struct Node *));
+    struct Run *runs = (struct Run *)malloc(nthreads * sizeof(struct Run));
+    pthread_t *threads = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+
+    if (splits == NULL || runs == NULL || threads == NULL) {
+        free(splits);
+        free(runs);
+        free(threads);
+        traverseList(list, f);
+        return;
+    }
+
+    /*
+     * Record split points in a single pass: splits[j] is node number
+     * j * stride.  Whenever the array fills up, keep every other split
+     * point and double the stride, so we never need to know the length
+     * of the list in advance.
+     */
+
+    size_t nsplits = 0, stride = 1, i = 0;
+
+    for (struct Node *node = list->head; node; node = node->next, i++) {
+        if (i % stride != 0)
+            continue;
+
+        if (nsplits == maxSplits) {
+            for (size_t j = 0; j < maxSplits / 2; j++)
+                splits[j] = splits[2 * j];
+            nsplits = maxSplits / 2;
+            stride *= 2;
+
+            if (i % stride != 0)
+                continue;
+        }
+
+        splits[nsplits++] = node;
+    }
+
+    /*
+     * Give each thread an equal share of the split points, and thus a
+     * run of roughly equal length.
+     */
+
+    size_t nruns = (size_t)nthreads < nsplits ? (size_t)nthreads : nsplits;
+
+    for (size_t r = 0; r < nruns; r++) {
+        size_t lo = r * nsplits / nruns, hi = (r + 1) * nsplits / nruns;
+        runs[r].first = splits[lo];
+        runs[r].end = hi < nsplits ? splits[hi] : NULL;
+        runs[r].f = f;
+    }
+
+    // Start a thread for every run but the first, which we handle
+    // ourselves.  If we can't start a thread, we do its run (and all
+    // the ones after it) ourselves too.
+    size_t started = 1;
+    while (started < nruns
+        && pthread_create(&threads[started], NULL, &traverseRun, &runs[started]) == 0)
+        started++;
+
+    traverseRun(&runs[0]);
+    for (size_t r = started; r < nruns; r++)
+        traverseRun(&runs[r]);
+
+    for (size_t r = 1; r < started; r++)
+        pthread_join(threads[r], NULL);
+
+    free(splits);
+    free(runs);
+    free(threads);
+}
@@ -0,0 +1,133 @@
+/*
+ * myqueue.c
+ *
+ *  The 'next' and index fields are plain (non-_Atomic) members, so we
+ *  access them with the __atomic builtins that gcc and clang provide.
+ */
+#include <stdlib.h>
+
+#include "myqueue.h"
+
+void initMpscQueue(struct MpscQueue *queue)
+{
+    queue->stub.data = NULL;
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+}
+
+void pushMpscQueue(struct MpscQueue *queue, struct Node *node)
+{
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+
+    // Claim the end of the queue, then link the old last node to us.
+    // Between these two steps the queue is briefly "broken", which is
+    // why popMpscQueue() can come up empty while an enqueue is running.
+    struct Node *prev = __atomic_exchange_n(&queue->head, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+struct Node *popMpscQueue(struct MpscQueue *queue)
+{
+    struct Node *tail = queue->tail;
+    struct Node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    // skip over the stub
+    if (tail == &queue->stub) {
+        if (next == NULL)
+            return NULL;
+        queue->tail = next;
+        tail = next;
+        next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+
+    // 'tail' looks like the last node.  If it isn't, a producer has
+    // claimed the end but not linked it up yet.
+    if (tail != __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    // Put the stub back behind 'tail' so that we can take 'tail' out.
+    pushMpscQueue(queue, &queue->stub);
+
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+int enqueueMpsc(struct MpscQueue *queue, void *data)
+{
+    struct Node *node = (struct Node *)malloc(sizeof(struct Node));
+    if (node == NULL)
+        return -1;
+
+    node->data = data;
+    pushMpscQueue(queue, node);
+    return 0;
+}
+
+void *dequeueMpsc(struct MpscQueue *queue)
+{
+    struct Node *node = popMpscQueue(queue);
+    if (node == NULL)
+        return NULL;
+
+    void *data = node->data;
+    free(node);
+    return data;
+}
+
+int initSpscRing(struct SpscRing *ring, size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size *= 2;
+
+    ring->slots = (void **)malloc(size * sizeof(void *));
+    if (ring->slots == NULL)
+        return -1;
+
+    ring->mask = size - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    return 0;
+}
+
+void freeSpscRing(struct SpscRing *ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+int pushSpscRing(struct SpscRing *ring, void *data)
+{
+    size_t tail = ring->tail;
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if (tail - head > ring->mask)
+        return -1;
+
+    ring->slots[tail & ring->mask] = data;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void *popSpscRing(struct SpscRing *ring)
+{
+    size_t head = ring->head;
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail)
+        return NULL;
+
+    void *data = ring->slots[head & ring->mask];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return data;
+}
@@ -0,0 +1,108 @@
+#ifndef _MYQUEUE_H_
+#define _MYQUEUE_H_
+
+#include <stddef.h>
+
+#include "mylist.h"
+
+/*
+ * Lock-free queues for handing work from one thread to another, e.g.
+ * from a thread that accept()s connections to the threads that serve
+ * them.  Programs that use them must be linked with -pthread.
+ */
+
+/*
+ * A multi-producer, single-consumer FIFO queue of struct Nodes.
+ *
+ * Any number of threads may enqueue at the same time, but only one
+ * thread at a time may dequeue.  Neither operation takes a lock:
+ * enqueueing is a single atomic exchange, and dequeueing normally
+ * doesn't need any atomic read-modify-write at all.
+ *
+ * 'head' is the most recently enqueued node and 'tail' the next one to
+ * be dequeued; 'stub' is a placeholder node that keeps the queue from
+ * ever becoming truly empty, which is what lets producers and the
+ * consumer work without touching the same pointer.
+ *
+ * A dequeue may return NULL while a producer is in the middle of an
+ * enqueue, even if other items have been enqueued; the consumer should
+ * simply try again later.
+ */
+struct MpscQueue {
+    struct Node *head;
+    struct Node *tail;
+    struct Node stub;
+};
+
+/*
+ * Initialize an empty queue.
+ */
+void initMpscQueue(struct MpscQueue *queue);
+
+/*
+ * Add 'node' to the end of the queue.  Its 'next' field is
+ * overwritten; its 'data' field is left alone.
+ */
+void pushMpscQueue(struct MpscQueue *queue, struct Node *node);
+
+/*
+ * Remove the node at the front of the queue and return it, or NULL if
+ * the queue is empty (see above).  Only one thread may call this at a
+ * time.
+ */
+struct Node *popMpscQueue(struct MpscQueue *queue);
+
+/*
+ * Allocate a node that holds 'data' and push it.  Returns 0 on success
+ * and -1 on failure.
+ */
+int enqueueMpsc(struct MpscQueue *queue, void *data);
+
+/*
+ * Pop a node, deallocate it, and return the data pointer it held.
+ * Returns NULL if the queue is empty.  Use this only for nodes added
+ * with enqueueMpsc().
+ */
+void *dequeueMpsc(struct MpscQueue *queue);
+
+/*
+ * A bounded single-producer, single-consumer FIFO ring of data
+ * pointers.
+ *
+ * One thread may push while another pops, without locks or atomic
+ * read-modify-write operations.  'tail' is only written by the
+ * producer and 'head' only by the consumer; they are kept on separate
+ * cache lines so that the two threads don't fight over them.
+ */
+struct SpscRing {
+    void **slots;
+    size_t mask;
+    _Alignas(64) size_t head;
+    _Alignas(64) size_t tail;
+};
+
+/*
+ * Initialize an empty ring that can hold at least 'capacity' items
+ * (rounded up to a power of 2).  Returns 0 on success and -1 on
+ * failure.
+ */
+int initSpscRing(struct SpscRing *ring, size_t capacity);
+
+/*
+ * Deallocate the ring's slots.
+ */
+void freeSpscRing(struct SpscRing *ring);
+
+/*
+ * Add 'data' to the end of the ring.  Returns 0 on success and -1 if
+ * the ring is full.
+ */
+int pushSpscRing(struct SpscRing *ring, void *data);
+
+/*
+ * Remove the item at the front of the ring and return it.  Returns
+ * NULL if the ring is empty.
+ */
+void *popSpscRing(struct SpscRing *ring);
+
+#endif /* #ifndef _MYQUEUE_H_ */
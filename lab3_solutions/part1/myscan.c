@@ -0,0 +1,238 @@
+/*
+ * myscan.c
+ *
+ *  The SIMD kernels are compiled with gcc/clang target attributes, so
+ *  this file needs no -msse2 or -mavx2 and runs on any x86 CPU; the
+ *  AVX2 code is only called once CPUID has said it's there.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <string.h>
+
+#include "myscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+int fieldContains(const char *f, size_t width, const char *key, size_t klen)
+{
+    size_t n = strnlen(f, width);
+
+    for (size_t i = 0; i + klen <= n; i++) {
+        size_t j = 0;
+        while (j < klen && f[i + j] == key[j])
+            j++;
+        if (j == klen)
+            return 1;
+    }
+    return 0;
+}
+
+static size_t scalarFields(const char *base, size_t stride, size_t width,
+    size_t count, const char *key, size_t klen, unsigned char *hits)
+{
+    size_t found = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!hits[i] && fieldContains(base + i * stride, width, key, klen)) {
+            hits[i] = 1;
+            found++;
+        }
+    }
+    return found;
+}
+
+#ifdef SCAN_X86
+
+// The SIMD kernels find the positions in a field where the first and
+// the last byte of the key both match ('m', one bit per position) and
+// where the field has a null byte ('z').  This checks the candidates:
+// the match must end before the string does, and the bytes between
+// the first and the last must match too.
+static int verifyField(const char *f, size_t width, uint32_t m, uint32_t z,
+    const char *key, size_t klen)
+{
+    // the string ends at the first null byte, or at the end of the field
+    if (width < 32)
+        z &= ((uint32_t)1 << width) - 1;
+    size_t n = z ? (size_t)__builtin_ctz(z) : width;
+    if (n < klen)
+        return 0;
+
+    // a match may start at positions 0 through n - klen
+    size_t lastStart = n - klen;
+    if (lastStart < 31)
+        m &= ((uint32_t)1 << (lastStart + 1)) - 1;
+
+    while (m) {
+        int p = __builtin_ctz(m);
+        if (klen <= 2 || memcmp(f + p + 1, key + 1, klen - 2) == 0)
+            return 1;
+        m &= m - 1;
+    }
+    return 0;
+}
+
+__attribute__((target("sse2")))
+static size_t sse2Fields(const char *base, size_t stride, size_t width,
+    size_t count, const char *key, size_t klen, unsigned char *hits)
+{
+    const __m128i first = _mm_set1_epi8(key[0]);
+    const __m128i last = _mm_set1_epi8(key[klen - 1]);
+    const __m128i zero = _mm_setzero_si128();
+    size_t found = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const char *f = base + i * stride;
+        if (hits[i])
+            continue;
+
+        // 'a' holds positions 0-15 and 'b' the bytes klen - 1 further
+        // on, so that a match starting at position p has its first
+        // byte in a[p] and its last in b[p]
+        __m128i a = _mm_loadu_si128((const __m128i *)f);
+        __m128i b = _mm_loadu_si128((const __m128i *)(f + klen - 1));
+        uint32_t m = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        uint32_t z = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero));
+
+        // positions 16-31
+        if (width > 16) {
+            a = _mm_loadu_si128((const __m128i *)(f + 16));
+            b = _mm_loadu_si128((const __m128i *)(f + 16 + klen - 1));
+            m |= (uint32_t)_mm_movemask_epi8(_mm_and_si128(
+                _mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))) << 16;
+            z |= (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) << 16;
+        }
+
+        if (m && verifyField(f, width, m, z, key, klen)) {
+            hits[i] = 1;
+            found++;
+        }
+    }
+    return found;
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Fields(const char *base, size_t stride, size_t width,
+    size_t count, const char *key, size_t klen, unsigned char *hits)
+{
+    const __m256i first = _mm256_set1_epi8(key[0]);
+    const __m256i last = _mm256_set1_epi8(key[klen - 1]);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t found = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const char *f = base + i * stride;
+        if (hits[i])
+            continue;
+
+        // all 32 positions at once; see sse2Fields()
+        __m256i a = _mm256_loadu_si256((const __m256i *)f);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(f + klen - 1));
+        uint32_t m = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+
+        if (m) {
+            uint32_t z = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero));
+            if (verifyField(f, width, m, z, key, klen)) {
+                hits[i] = 1;
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+#endif /* SCAN_X86 */
+
+enum ScanKernel bestScanKernel(void)
+{
+    // -1 until the first call has asked the CPU
+    static int best = -1;
+
+    int kernel = __atomic_load_n(&best, __ATOMIC_RELAXED);
+    if (kernel >= 0)
+        return (enum ScanKernel)kernel;
+
+    kernel = SCAN_SCALAR;
+#ifdef SCAN_X86
+    // __builtin_cpu_supports() runs CPUID, and for AVX2 also checks that
+    // the OS saves the YMM registers
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        kernel = SCAN_AVX2;
+    else if (__builtin_cpu_supports("sse2"))
+        kernel = SCAN_SSE2;
+#endif
+
+    __atomic_store_n(&best, kernel, __ATOMIC_RELAXED);
+    return (enum ScanKernel)kernel;
+}
+
+const char *scanKernelName(enum ScanKernel kernel)
+{
+    switch (kernel) {
+    case SCAN_SSE2:
+        return "sse2";
+    case SCAN_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+size_t scanFieldsWith(enum ScanKernel kernel, const char *base,
+    size_t stride, size_t width, size_t count, const char *key,
+    unsigned char *hits)
+{
+    size_t klen = strlen(key);
+
+    if (count == 0 || klen > width)
+        return 0;
+
+    // every string contains the empty string
+    if (klen == 0) {
+        size_t found = 0;
+        for (size_t i = 0; i < count; i++) {
+            found += !hits[i];
+            hits[i] = 1;
+        }
+        return found;
+    }
+
+    if (kernel == SCAN_SCALAR || width > SCAN_MAX_WIDTH)
+        return scalarFields(base, stride, width, count, key, klen, hits);
+
+#ifdef SCAN_X86
+    /*
+     * The SIMD kernels read 'span' bytes from the start of a field.
+     * Fields close enough to the end that this would run past the last
+     * field are left to the scalar kernel.
+     */
+
+    size_t span = klen - 1 + (kernel == SCAN_AVX2 || width > 16 ? 32 : 16);
+    size_t total = (count - 1) * stride + width;
+    size_t safe = total >= span ? (total - span) / stride + 1 : 0;
+    if (safe > count)
+        safe = count;
+
+    size_t found = kernel == SCAN_AVX2
+        ? avx2Fields(base, stride, width, safe, key, klen, hits)
+        : sse2Fields(base, stride, width, safe, key, klen, hits);
+
+    return found + scalarFields(base + safe * stride, stride, width,
+        count - safe, key, klen, hits + safe);
+#else
+    return scalarFields(base, stride, width, count, key, klen, hits);
+#endif
+}
+
+size_t scanFields(const char *base, size_t stride, size_t width,
+    size_t count, const char *key, unsigned char *hits)
+{
+    return scanFieldsWith(bestScanKernel(), base, stride, width, count,
+        key, hits);
+}
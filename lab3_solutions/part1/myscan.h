@@ -0,0 +1,77 @@
+#ifndef _MYSCAN_H_
+#define _MYSCAN_H_
+
+#include <stddef.h>
+
+/*
+ * Substring search over many short fixed-width text fields, such as
+ * the names and msgs of mdb records.
+ *
+ * The fields are 'width' bytes wide and 'stride' bytes apart: a
+ * column of fields has 'stride' equal to 'width', and a field inside
+ * an array of structs has the struct's size as 'stride'.  Each field
+ * holds a string that is null-terminated unless it fills the whole
+ * field, and a key matches a field the way strstr() would.
+ *
+ * On x86, the fields are searched with SSE2 or AVX2: the first and
+ * last bytes of the key are compared against 16 or 32 positions of a
+ * field at once, and only positions where both match are verified
+ * byte by byte.  The kernel is picked at run time from what the CPU
+ * supports (see bestScanKernel()), and a portable scalar kernel is
+ * used everywhere else.
+ */
+
+enum ScanKernel {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2,
+};
+
+/*
+ * Returns the fastest kernel this CPU supports, as reported by CPUID.
+ */
+enum ScanKernel bestScanKernel(void);
+
+/*
+ * Returns a name for 'kernel', for messages and benchmarks.
+ */
+const char *scanKernelName(enum ScanKernel kernel);
+
+/*
+ * Test the null-terminated 'key' against the 'count' fields at 'base'
+ * and set hits[i] to 1 for each field i that contains it.  Fields whose
+ * entry in 'hits' is already set are skipped, so scanning several
+ * fields of the same records into one 'hits' array ORs the results
+ * together, and only tests a record's later fields if its earlier ones
+ * didn't match.
+ *
+ * The SIMD kernels may read past the end of a field into the bytes
+ * that follow it, but never past the end of the last field.  Fields
+ * wider than SCAN_MAX_WIDTH bytes are always searched with the scalar
+ * kernel.
+ *
+ * Returns the number of entries of 'hits' newly set.
+ */
+size_t scanFields(const char *base, size_t stride, size_t width,
+    size_t count, const char *key, unsigned char *hits);
+
+#define SCAN_MAX_WIDTH 32
+
+/*
+ * Returns 1 if the single field of 'width' bytes at 'field' contains
+ * the 'klen' bytes of 'key', by the same rules as scanFields(), and 0
+ * otherwise.  Never reads past the end of the field.
+ */
+int fieldContains(const char *field, size_t width, const char *key,
+    size_t klen);
+
+/*
+ * Same as scanFields(), but with the given kernel, which must be
+ * supported by the CPU.  This is for testing and benchmarking kernels
+ * against each other.
+ */
+size_t scanFieldsWith(enum ScanKernel kernel, const char *base,
+    size_t stride, size_t width, size_t count, const char *key,
+    unsigned char *hits);
+
+#endif /* #ifndef _MYSCAN_H_ */
@@ -0,0 +1,158 @@
+/*
+ * myskiplist.c
+ */
+#include <stdlib.h>
+
+#include "myskiplist.h"
+
+void initSkipList(struct SkipList *list,
+    int (*compar)(const void *, const void *))
+{
+    for (int i = 0; i < SKIP_MAX_LEVEL; i++)
+        list->head[i] = NULL;
+    list->level = 0;
+    list->length = 0;
+    list->compar = compar;
+    list->seed = 0x9E3779B97F4A7C15ULL;
+}
+
+// Pick a level for a new node: 1 with probability 1/2, 2 with
+// probability 1/4, and so on.  The bits come from a xorshift64*
+// generator, which is plenty random for this.
+static int randomLevel(struct SkipList *list)
+{
+    unsigned long long x = list->seed;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    list->seed = x;
+    x *= 0x2545F4914F6CDD1DULL;
+
+    int level = 1;
+    while (level < SKIP_MAX_LEVEL && (x & 1)) {
+        level++;
+        x >>= 1;
+    }
+    return level;
+}
+
+// Walk down from the top level towards 'key'.  Stops before the first
+// node whose item is greater than 'key', or, if 'after' is 0, greater
+// than or equal to it.
+//
+// If 'update' is not NULL, update[i] is set to the link on level i
+// that leads to where the search stopped, which is where a node would
+// be linked in or out.  Returns the node the search stopped at on
+// level 0.
+static struct SkipNode *search(struct SkipList *list, const void *key,
+    int after, struct SkipNode **update[])
+{
+    struct SkipNode *prev = NULL;
+    struct SkipNode **link = &list->head[0];
+
+    for (int i = list->level - 1; i >= 0; i--) {
+        link = prev ? &prev->next[i] : &list->head[i];
+
+        while (*link) {
+            int c = list->compar((*link)->data, key);
+            if (c > 0 || (c == 0 && !after))
+                break;
+            prev = *link;
+            link = &prev->next[i];
+        }
+
+        if (update)
+            update[i] = link;
+    }
+
+    return *link;
+}
+
+struct SkipNode *insertSkipList(struct SkipList *list, void *data)
+{
+    struct SkipNode **update[SKIP_MAX_LEVEL];
+    search(list, data, 1, update);
+
+    int level = randomLevel(list);
+    struct SkipNode *node = (struct SkipNode *)malloc(
+        sizeof(struct SkipNode) + level * sizeof(struct SkipNode *));
+    if (node == NULL)
+        return NULL;
+
+    // levels above the current top are reached straight from the head
+    for (; list->level < level; list->level++)
+        update[list->level] = &list->head[list->level];
+
+    node->data = data;
+    node->level = level;
+    for (int i = 0; i < level; i++) {
+        node->next[i] = *update[i];
+        *update[i] = node;
+    }
+
+    list->length++;
+    return node;
+}
+
+struct SkipNode *lowerBoundSkipList(struct SkipList *list, const void *key)
+{
+    return search(list, key, 0, NULL);
+}
+
+struct SkipNode *findSkipList(struct SkipList *list, const void *key)
+{
+    struct SkipNode *node = search(list, key, 0, NULL);
+    if (node && list->compar(node->data, key) == 0)
+        return node;
+    return NULL;
+}
+
+void traverseRangeSkipList(struct SkipList *list, const void *low,
+    const void *high, void (*f)(void *))
+{
+    struct SkipNode *node = search(list, low, 0, NULL);
+
+    while (node && (high == NULL || list->compar(node->data, high) < 0)) {
+        f(node->data);
+        node = node->next[0];
+    }
+}
+
+void traverseSkipList(struct SkipList *list, void (*f)(void *))
+{
+    for (struct SkipNode *node = list->head[0]; node; node = node->next[0])
+        f(node->data);
+}
+
+void *removeSkipList(struct SkipList *list, const void *key)
+{
+    struct SkipNode **update[SKIP_MAX_LEVEL];
+    struct SkipNode *node = search(list, key, 0, update);
+
+    if (node == NULL || list->compar(node->data, key) != 0)
+        return NULL;
+
+    // 'node' is the first item not less than 'key', so on each of its
+    // levels, the link we stopped at points right to it
+    for (int i = 0; i < node->level; i++)
+        *update[i] = node->next[i];
+
+    while (list->level > 0 && list->head[list->level - 1] == NULL)
+        list->level--;
+
+    void *data = node->data;
+    free(node);
+    list->length--;
+    return data;
+}
+
+void removeAllSkipList(struct SkipList *list)
+{
+    struct SkipNode *node = list->head[0];
+    while (node) {
+        struct SkipNode *next = node->next[0];
+        free(node);
+        node = next;
+    }
+    initSkipList(list, list->compar);
+}
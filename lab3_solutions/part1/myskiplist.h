@@ -0,0 +1,134 @@
+#ifndef _MYSKIPLIST_H_
+#define _MYSKIPLIST_H_
+
+#include <stddef.h>
+
+/*
+ * A skip list: a sorted linked list with express lanes.
+ *
+ * Every node is on level 0, which links all items in order.  About
+ * half of the nodes are also on level 1, a quarter on level 2, and so
+ * on, each level skipping over the nodes that are only on the levels
+ * below.  A search starts on the highest level and drops down a level
+ * whenever the next step would overshoot, so insertion, search and
+ * removal take expected O(log n) steps instead of O(n).
+ *
+ * Items are ordered by a qsort()-style comparison function over data
+ * pointers, as in sortList().  Equal items are allowed and are kept in
+ * the order they were inserted.  Like the other lists, a skip list only
+ * stores the data pointers and does not manage their lifetime.
+ */
+
+#define SKIP_MAX_LEVEL 32
+
+/*
+ * A node in a skip list.
+ * 'next[0]' through 'next[level - 1]' are the node's successors on each
+ * of its levels; 'next[0]' is the next node in order.
+ */
+struct SkipNode {
+    void *data;
+    int level;
+    struct SkipNode *next[];
+};
+
+/*
+ * A skip list.
+ *
+ * 'head[i]' points to the first node on level i, and 'level' is the
+ * number of levels in use.  'compar' orders the data items.  'seed' is
+ * the state of the random number generator that picks node levels.
+ */
+struct SkipList {
+    struct SkipNode *head[SKIP_MAX_LEVEL];
+    int level;
+    size_t length;
+    int (*compar)(const void *, const void *);
+    unsigned long long seed;
+};
+
+/*
+ * Initialize an empty skip list ordered by 'compar'.
+ */
+void initSkipList(struct SkipList *list,
+    int (*compar)(const void *, const void *));
+
+/*
+ * Returns 1 if the skip list is empty, 0 otherwise.
+ */
+static inline int isEmptySkipList(struct SkipList *list)
+{
+    return (list->head[0] == 0);
+}
+
+/*
+ * Returns the number of items in the skip list.
+ */
+static inline size_t lengthSkipList(struct SkipList *list)
+{
+    return list->length;
+}
+
+/*
+ * Returns the first node of the skip list, or NULL if it is empty.
+ * Together with nextSkipNode(), this iterates over the items in order.
+ */
+static inline struct SkipNode *firstSkipNode(struct SkipList *list)
+{
+    return list->head[0];
+}
+
+/*
+ * Returns the node after 'node' in order, or NULL if 'node' is the
+ * last one.
+ */
+static inline struct SkipNode *nextSkipNode(struct SkipNode *node)
+{
+    return node->next[0];
+}
+
+/*
+ * Insert the data pointer in order, after any items equal to it.
+ *
+ * Returns the newly created node, or NULL if malloc() failed.
+ */
+struct SkipNode *insertSkipList(struct SkipList *list, void *data);
+
+/*
+ * Returns the first node whose item is equal to 'key', or NULL if there
+ * is none.  'key' is compared with the items using the list's 'compar'
+ * function, so it has to be of the same type as the items.
+ */
+struct SkipNode *findSkipList(struct SkipList *list, const void *key);
+
+/*
+ * Returns the first node whose item is not less than 'key', or NULL if
+ * every item is less than 'key'.
+ */
+struct SkipNode *lowerBoundSkipList(struct SkipList *list, const void *key);
+
+/*
+ * Call f() with each item that is not less than 'low' and less than
+ * 'high', in order.  If 'high' is NULL, the range has no upper end.
+ * f() must not modify the list.
+ */
+void traverseRangeSkipList(struct SkipList *list, const void *low,
+    const void *high, void (*f)(void *));
+
+/*
+ * Traverse the skip list in order, calling f() with each item.
+ */
+void traverseSkipList(struct SkipList *list, void (*f)(void *));
+
+/*
+ * Remove the first item equal to 'key' from the list and return its
+ * data pointer.  Returns NULL if there is no such item.
+ */
+void *removeSkipList(struct SkipList *list, const void *key);
+
+/*
+ * Remove all items from the list, deallocating the nodes.
+ */
+void removeAllSkipList(struct SkipList *list);
+
+#endif /* #ifndef _MYSKIPLIST_H_ */
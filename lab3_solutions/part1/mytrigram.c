@@ -0,0 +1,397 @@
+/*
+ * mytrigram.c
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mytrigram.h"
+
+// Upper bound on the number of posting lists intersected per search.
+// A longer key just gets more candidates to verify.
+#define TRIGRAM_MAX_LISTS 16
+
+/*
+ * The block holding an index, and the sidecar file, start with this
+ * header, followed by the 'trigrams', 'offsets' and 'postings' arrays.
+ */
+struct TrigramHeader {
+    char magic[8];
+    uint64_t count;
+    uint64_t recSize;
+    uint64_t recHash;
+    uint64_t ntrigrams;
+    uint64_t npostings;
+};
+
+static const char trigramMagic[8] = "TRIGRAM2";
+
+static size_t blockSizeFor(uint64_t ntrigrams, uint64_t npostings)
+{
+    return sizeof(struct TrigramHeader)
+        + (ntrigrams + ntrigrams + 1 + npostings) * sizeof(uint32_t);
+}
+
+// Point the index at the arrays in 'block', which starts with a valid
+// header.
+static void attach(struct TrigramIndex *index, void *block, size_t blockSize,
+    int mapped)
+{
+    struct TrigramHeader *h = (struct TrigramHeader *)block;
+    const uint32_t *arrays = (const uint32_t *)(h + 1);
+
+    index->count = h->count;
+    index->recSize = h->recSize;
+    index->recHash = h->recHash;
+    index->ntrigrams = h->ntrigrams;
+    index->trigrams = arrays;
+    index->offsets = arrays + h->ntrigrams;
+    index->postings = arrays + h->ntrigrams + h->ntrigrams + 1;
+    index->block = block;
+    index->blockSize = blockSize;
+    index->mapped = mapped;
+}
+
+void initTrigramIndex(struct TrigramIndex *index)
+{
+    memset(index, 0, sizeof(*index));
+}
+
+void freeTrigramIndex(struct TrigramIndex *index)
+{
+    if (index->mapped)
+        munmap(index->block, index->blockSize);
+    else
+        free(index->block);
+    initTrigramIndex(index);
+}
+
+static int compareU32(const void *p1, const void *p2)
+{
+    uint32_t a = *(const uint32_t *)p1, b = *(const uint32_t *)p2;
+    return (a > b) - (a < b);
+}
+
+static int compareU64(const void *p1, const void *p2)
+{
+    uint64_t a = *(const uint64_t *)p1, b = *(const uint64_t *)p2;
+    return (a > b) - (a < b);
+}
+
+// Hash the 'size' bytes at 'p', eight at a time.  This runs over every
+// record an index covers each time the index is loaded, so it has to
+// be cheap next to building the index.
+static uint64_t hashBytes(const void *p, size_t size)
+{
+    const unsigned char *b = (const unsigned char *)p;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ size;
+    uint64_t w;
+
+    for (; size >= 8; b += 8, size -= 8) {
+        memcpy(&w, b, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+
+    // 'p' may be NULL when there are no bytes at all
+    w = 0;
+    if (size > 0)
+        memcpy(&w, b, size);
+    h = (h ^ w) * 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 29);
+}
+
+static uint32_t trigramAt(const unsigned char *s)
+{
+    return (uint32_t)s[0] << 16 | (uint32_t)s[1] << 8 | s[2];
+}
+
+int buildTrigramIndex(struct TrigramIndex *index, const void *recs,
+    size_t count, size_t recSize, const struct TextField *fields, int nfields)
+{
+    freeTrigramIndex(index);
+
+    // record numbers and posting offsets are stored as uint32_t
+    if (count > UINT32_MAX)
+        return -1;
+
+    /*
+     * Collect a (trigram, record) pair for every distinct trigram of
+     * every record, with the trigram in the high half so that sorting
+     * the pairs groups them by trigram and then by record.
+     */
+
+    struct Vec tris, pairs;
+    initRecVec(&tris, sizeof(uint32_t));
+    initRecVec(&pairs, sizeof(uint64_t));
+
+    for (size_t id = 0; id < count; id++) {
+        const char *rec = (const char *)recs + id * recSize;
+
+        clearVec(&tris);
+        for (int f = 0; f < nfields; f++) {
+            const unsigned char *s =
+                (const unsigned char *)rec + fields[f].offset;
+            size_t len = strnlen((const char *)s, fields[f].width);
+
+            for (size_t i = 0; i + 3 <= len; i++) {
+                uint32_t t = trigramAt(s + i);
+                if (pushRecVec(&tris, &t) == NULL)
+                    goto fail;
+            }
+        }
+
+        size_t n = vecLength(&tris);
+        if (n == 0)
+            continue;
+        uint32_t *t = (uint32_t *)vecAt(&tris, 0);
+        qsort(t, n, sizeof(uint32_t), &compareU32);
+
+        for (size_t i = 0; i < n; i++) {
+            if (i > 0 && t[i] == t[i - 1])
+                continue;
+            uint64_t pair = (uint64_t)t[i] << 32 | id;
+            if (pushRecVec(&pairs, &pair) == NULL)
+                goto fail;
+        }
+    }
+
+    size_t npostings = vecLength(&pairs);
+    if (npostings > UINT32_MAX)
+        goto fail;
+
+    uint64_t *p = npostings ? (uint64_t *)vecAt(&pairs, 0) : NULL;
+    if (npostings)
+        qsort(p, npostings, sizeof(uint64_t), &compareU64);
+
+    size_t ntrigrams = 0;
+    for (size_t i = 0; i < npostings; i++) {
+        if (i == 0 || p[i] >> 32 != p[i - 1] >> 32)
+            ntrigrams++;
+    }
+
+    /*
+     * Lay the index out in a block shaped like the sidecar file.
+     */
+
+    size_t blockSize = blockSizeFor(ntrigrams, npostings);
+    struct TrigramHeader *h = (struct TrigramHeader *)malloc(blockSize);
+    if (h == NULL)
+        goto fail;
+
+    memcpy(h->magic, trigramMagic, sizeof(h->magic));
+    h->count = count;
+    h->recSize = recSize;
+    h->recHash = hashBytes(recs, count * recSize);
+    h->ntrigrams = ntrigrams;
+    h->npostings = npostings;
+
+    uint32_t *trigrams = (uint32_t *)(h + 1);
+    uint32_t *offsets = trigrams + ntrigrams;
+    uint32_t *postings = offsets + ntrigrams + 1;
+    size_t k = 0;
+
+    for (size_t i = 0; i < npostings; i++) {
+        if (i == 0 || p[i] >> 32 != p[i - 1] >> 32) {
+            trigrams[k] = (uint32_t)(p[i] >> 32);
+            offsets[k++] = (uint32_t)i;
+        }
+        postings[i] = (uint32_t)p[i];
+    }
+    offsets[ntrigrams] = (uint32_t)npostings;
+
+    attach(index, h, blockSize, 0);
+    freeVec(&tris);
+    freeVec(&pairs);
+    return 0;
+
+fail:
+    freeVec(&tris);
+    freeVec(&pairs);
+    return -1;
+}
+
+int checkTrigramIndex(const struct TrigramIndex *index, const void *recs,
+    size_t count, size_t recSize)
+{
+    return index->block != NULL && index->recSize == recSize
+        && index->count <= count
+        && hashBytes(recs, index->count * recSize) == index->recHash;
+}
+
+// Returns the index of 't' in the sorted 'trigrams' array, or -1.
+static long findTrigram(const struct TrigramIndex *index, uint32_t t)
+{
+    size_t lo = 0, hi = index->ntrigrams;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->trigrams[mid] < t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < index->ntrigrams && index->trigrams[lo] == t)
+        return (long)lo;
+    return -1;
+}
+
+int findTrigramCandidates(const struct TrigramIndex *index, const char *key,
+    struct Vec *ids)
+{
+    size_t len = strlen(key);
+    if (len < 3)
+        return -1;
+
+    /*
+     * Look up the posting list of each trigram of the key.  A trigram
+     * with no posting list means no record can match.
+     */
+
+    const uint32_t *begin[TRIGRAM_MAX_LISTS], *end[TRIGRAM_MAX_LISTS];
+    int nlists = 0, shortest = 0;
+
+    for (size_t i = 0; i + 3 <= len && nlists < TRIGRAM_MAX_LISTS; i++) {
+        long t = findTrigram(index, trigramAt((const unsigned char *)key + i));
+        if (t < 0)
+            return 0;
+
+        begin[nlists] = index->postings + index->offsets[t];
+        end[nlists] = index->postings + index->offsets[t + 1];
+        if (end[nlists] - begin[nlists] < end[shortest] - begin[shortest])
+            shortest = nlists;
+        nlists++;
+    }
+
+    /*
+     * Walk the shortest list, keeping a cursor into each of the others;
+     * all lists are sorted, so the cursors only ever move forward.
+     */
+
+    int found = 0;
+
+    for (const uint32_t *p = begin[shortest]; p < end[shortest]; p++) {
+        int inAll = 1;
+
+        for (int l = 0; l < nlists && inAll; l++) {
+            if (l == shortest)
+                continue;
+            while (begin[l] < end[l] && *begin[l] < *p)
+                begin[l]++;
+            if (begin[l] == end[l] || *begin[l] != *p)
+                inAll = 0;
+        }
+
+        if (inAll) {
+            if (pushRecVec(ids, p) == NULL)
+                return -1;
+            found++;
+        }
+    }
+
+    return found;
+}
+
+int saveTrigramIndex(const struct TrigramIndex *index, const char *filename)
+{
+    // an index that was never built or loaded has nothing to save
+    if (index->block == NULL)
+        return -1;
+
+    size_t len = strlen(filename);
+    char *tmpname = (char *)malloc(len + sizeof(".XXXXXX"));
+    int fd = -1;
+    if (tmpname == NULL)
+        goto fail;
+
+    memcpy(tmpname, filename, len);
+    memcpy(tmpname + len, ".XXXXXX", sizeof(".XXXXXX"));
+
+    if ((fd = mkstemp(tmpname)) < 0)
+        goto fail;
+
+    // mkstemp() creates the file for the owner only
+    if (fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) < 0)
+        goto fail_unlink;
+
+    const char *p = (const char *)index->block;
+    size_t left = index->blockSize;
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0)
+            goto fail_unlink;
+        p += n;
+        left -= (size_t)n;
+    }
+
+    if (close(fd) < 0) {
+        fd = -1;
+        goto fail_unlink;
+    }
+    fd = -1;
+
+    if (rename(tmpname, filename) < 0)
+        goto fail_unlink;
+
+    free(tmpname);
+    return 0;
+
+fail_unlink:
+    unlink(tmpname);
+fail:
+    if (fd >= 0)
+        close(fd);
+    free(tmpname);
+    return -1;
+}
+
+int loadTrigramIndex(struct TrigramIndex *index, const char *filename)
+{
+    freeTrigramIndex(index);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct TrigramHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *block = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (block == MAP_FAILED)
+        return -1;
+
+    // check that the header describes exactly this much data
+    struct TrigramHeader *h = (struct TrigramHeader *)block;
+    if (memcmp(h->magic, trigramMagic, sizeof(h->magic)) != 0
+        || h->count > UINT32_MAX || h->ntrigrams > UINT32_MAX
+        || h->npostings > UINT32_MAX
+        || blockSizeFor(h->ntrigrams, h->npostings) != size) {
+        munmap(block, size);
+        return -1;
+    }
+
+    attach(index, block, size, 1);
+
+    // a corrupt offsets array would send searches out of bounds
+    int valid = index->offsets[0] == 0
+        && index->offsets[index->ntrigrams] == h->npostings;
+    for (size_t i = 0; valid && i < index->ntrigrams; i++)
+        valid = index->offsets[i] <= index->offsets[i + 1];
+
+    if (!valid) {
+        freeTrigramIndex(index);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#ifndef _MYTRIGRAM_H_
+#define _MYTRIGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "myvec.h"
+
+/*
+ * A trigram index for substring search over an array of fixed-size
+ * records with fixed-width text fields, such as the records of an mdb
+ * database.
+ *
+ * For every trigram (three consecutive bytes) that occurs in any text
+ * field, the index keeps a posting list: the sorted numbers of the
+ * records containing it.  Every trigram of a key must occur in a record
+ * that contains the key, so intersecting the posting lists of the key's
+ * trigrams narrows a search down to a few candidate records, which the
+ * caller then checks with strstr().  Keys shorter than three bytes have
+ * no trigrams, and need a full scan.
+ *
+ * The index is stored in compressed sparse row form: 'trigrams' holds
+ * the distinct trigrams in increasing order, and the posting list of
+ * trigrams[i] is postings[offsets[i]] through
+ * postings[offsets[i + 1] - 1].  These arrays all live in one block
+ * laid out exactly like the sidecar file that saveTrigramIndex()
+ * writes, so saving is a single write and loading is a single mmap().
+ *
+ * An index covers records 0 through 'count' - 1.  The records it was
+ * built from may have grown since (a database is append-only), in
+ * which case the caller scans the records past 'count'.  'recHash' is
+ * a hash of the records it covers, which checkTrigramIndex() uses to
+ * tell whether a saved index still belongs to the records at hand.
+ */
+
+/*
+ * A text field within a record: 'width' bytes at 'offset', holding a
+ * string that is null-terminated unless it fills the whole field.
+ */
+struct TextField {
+    size_t offset;
+    size_t width;
+};
+
+struct TrigramIndex {
+    size_t count;
+    size_t recSize;
+    uint64_t recHash;
+    size_t ntrigrams;
+    const uint32_t *trigrams;
+    const uint32_t *offsets;
+    const uint32_t *postings;
+    void *block;
+    size_t blockSize;
+    int mapped;
+};
+
+/*
+ * Initialize an empty index, which covers no records.
+ */
+void initTrigramIndex(struct TrigramIndex *index);
+
+/*
+ * Build an index over 'count' records of 'recSize' bytes each starting
+ * at 'recs', covering the 'nfields' text fields described by 'fields'.
+ * Any index previously held in 'index' is freed first.
+ *
+ * Returns 0 on success and -1 on failure, leaving 'index' empty.
+ */
+int buildTrigramIndex(struct TrigramIndex *index, const void *recs,
+    size_t count, size_t recSize, const struct TextField *fields, int nfields);
+
+/*
+ * Append to the record-mode vector 'ids' (whose records must be
+ * uint32_t) the numbers of the records, in increasing order, that
+ * contain every trigram of the null-terminated 'key'.  Every record
+ * that contains 'key' is among them, but some of them may not contain
+ * it.
+ *
+ * Returns the number of record numbers appended, or -1 if the index
+ * can't help, because 'key' is shorter than three characters or memory
+ * ran out.  The caller should then scan all records instead.
+ */
+int findTrigramCandidates(const struct TrigramIndex *index, const char *key,
+    struct Vec *ids);
+
+/*
+ * Returns 1 if the index was built from the first 'index->count' of
+ * the 'count' records of 'recSize' bytes each at 'recs', and 0 if not.
+ * That is always the case for an index just built from them, but an
+ * index loaded from a file may belong to a database that has since
+ * been replaced or rewritten.  An empty index belongs to no records.
+ */
+int checkTrigramIndex(const struct TrigramIndex *index, const void *recs,
+    size_t count, size_t recSize);
+
+/*
+ * Write the index to the file 'filename'.  The file is written under a
+ * temporary name and renamed into place, so concurrent readers see
+ * either the old index or the new one.
+ *
+ * The index must have been built or loaded.  The file is in native
+ * byte order and not meant to be moved between machines.  Returns 0 on
+ * success and -1 on failure.
+ */
+int saveTrigramIndex(const struct TrigramIndex *index, const char *filename);
+
+/*
+ * Map an index saved by saveTrigramIndex() from 'filename' into memory
+ * read-only.  Any index previously held in 'index' is freed first.
+ *
+ * Returns 0 on success, or -1 if the file can't be read or is not a
+ * valid index, leaving 'index' empty.  Check that the index belongs to
+ * the records it is to be used with before using it.
+ */
+int loadTrigramIndex(struct TrigramIndex *index, const char *filename);
+
+/*
+ * Free the index, leaving it empty.
+ */
+void freeTrigramIndex(struct TrigramIndex *index);
+
+#endif /* #ifndef _MYTRIGRAM_H_ */
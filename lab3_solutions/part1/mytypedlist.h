@@ -0,0 +1,135 @@
+#ifndef _MYTYPEDLIST_H_
+#define _MYTYPEDLIST_H_
+
+#include <stdlib.h>
+
+/*
+ * Typed linked lists
+ *
+ * DEFINE_LIST(Name, Type) defines a linked list whose nodes hold a
+ * value of type 'Type' directly (instead of a void * to it), along
+ * with the functions that operate on it.  For example:
+
+      DEFINE_LIST(MdbRec, struct MdbRec)
+
+ * defines struct MdbRecNode, struct MdbRecList, initMdbRecList(),
+ * addMdbRecFront(), findMdbRecNode() and so on.  'Name' must be a
+ * plain identifier; 'Type' can be any type that can be assigned.
+ *
+ * Everything is defined as static inline functions in the header.  As
+ * a result, when traverse##Name##List() or find##Name##Node() is called
+ * with a function whose definition the compiler can see, an optimizing
+ * compiler inlines the callback into the loop, instead of making an
+ * indirect call per element as traverseList() and findNode() in
+ * libmylist.a must.
+ *
+ * The functions behave like their counterparts in mylist.h, except
+ * that values are copied into and out of the nodes.
+ */
+
+#define DEFINE_LIST(Name, Type)                                               \
+                                                                              \
+    struct Name##Node {                                                       \
+        Type data;                                                            \
+        struct Name##Node *next;                                              \
+    };                                                                        \
+                                                                              \
+    struct Name##List {                                                       \
+        struct Name##Node *head;                                              \
+    };                                                                        \
+                                                                              \
+    static inline void init##Name##List(struct Name##List *list)              \
+    {                                                                         \
+        list->head = 0;                                                       \
+    }                                                                         \
+                                                                              \
+    static inline int isEmpty##Name##List(struct Name##List *list)            \
+    {                                                                         \
+        return (list->head == 0);                                             \
+    }                                                                         \
+                                                                              \
+    static inline struct Name##Node *add##Name##After(                        \
+        struct Name##List *list, struct Name##Node *prevNode, Type value)     \
+    {                                                                         \
+        struct Name##Node *node =                                             \
+            (struct Name##Node *)malloc(sizeof(struct Name##Node));           \
+        if (node == 0)                                                        \
+            return 0;                                                         \
+                                                                              \
+        node->data = value;                                                   \
+        if (prevNode) {                                                       \
+            node->next = prevNode->next;                                      \
+            prevNode->next = node;                                            \
+        } else {                                                              \
+            node->next = list->head;                                          \
+            list->head = node;                                                \
+        }                                                                     \
+        return node;                                                          \
+    }                                                                         \
+                                                                              \
+    static inline struct Name##Node *add##Name##Front(                        \
+        struct Name##List *list, Type value)                                  \
+    {                                                                         \
+        return add##Name##After(list, 0, value);                              \
+    }                                                                         \
+                                                                              \
+    /* Copies the first value into '*value' and removes its node.          */ \
+    /* Returns 0 if the list is empty, 1 otherwise.                        */ \
+    static inline int pop##Name##Front(struct Name##List *list, Type *value)  \
+    {                                                                         \
+        struct Name##Node *oldHead = list->head;                              \
+        if (oldHead == 0)                                                     \
+            return 0;                                                         \
+                                                                              \
+        list->head = oldHead->next;                                           \
+        *value = oldHead->data;                                               \
+        free(oldHead);                                                        \
+        return 1;                                                             \
+    }                                                                         \
+                                                                              \
+    static inline void traverse##Name##List(                                  \
+        struct Name##List *list, void (*f)(Type *))                           \
+    {                                                                         \
+        for (struct Name##Node *node = list->head; node; node = node->next)  \
+            f(&node->data);                                                   \
+    }                                                                         \
+                                                                              \
+    static inline struct Name##Node *find##Name##Node(                        \
+        struct Name##List *list, const void *dataSought,                      \
+        int (*compar)(const void *, const Type *))                            \
+    {                                                                         \
+        for (struct Name##Node *node = list->head; node; node = node->next) { \
+            if (compar(dataSought, &node->data) == 0)                         \
+                return node;                                                  \
+        }                                                                     \
+        return 0;                                                             \
+    }                                                                         \
+                                                                              \
+    static inline void reverse##Name##List(struct Name##List *list)           \
+    {                                                                         \
+        struct Name##Node *prv = 0;                                           \
+        struct Name##Node *cur = list->head;                                  \
+        struct Name##Node *nxt;                                               \
+                                                                              \
+        while (cur) {                                                         \
+            nxt = cur->next;                                                  \
+            cur->next = prv;                                                  \
+            prv = cur;                                                        \
+            cur = nxt;                                                        \
+        }                                                                     \
+                                                                              \
+        list->head = prv;                                                     \
+    }                                                                         \
+                                                                              \
+    static inline void removeAll##Name##Nodes(struct Name##List *list)        \
+    {                                                                         \
+        struct Name##Node *node = list->head;                                 \
+        while (node) {                                                        \
+            struct Name##Node *next = node->next;                             \
+            free(node);                                                       \
+            node = next;                                                      \
+        }                                                                     \
+        list->head = 0;                                                       \
+    }
+
+#endif /* #ifndef _MYTYPEDLIST_H_ */
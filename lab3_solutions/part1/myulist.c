@@ -0,0 +1,158 @@
+/*
+ * myulist.c
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "myulist.h"
+
+static struct UBlock *newBlock(struct UBlock *next)
+{
+    struct UBlock *block =
+        (struct UBlock *)aligned_alloc(64, sizeof(struct UBlock));
+    if (block == NULL)
+        return NULL;
+
+    block->next = next;
+    block->count = 0;
+    return block;
+}
+
+// Put 'data' at 'index' in a block that is not full, shifting the
+// items after it up by one.
+static struct UPos insertAt(struct UBlock *block, size_t index, void *data)
+{
+    memmove(&block->data[index + 1], &block->data[index],
+        (block->count - index) * sizeof(void *));
+    block->data[index] = data;
+    block->count++;
+
+    struct UPos pos = { block, index };
+    return pos;
+}
+
+struct UPos addFrontUList(struct UList *list, void *data)
+{
+    if (list->head == NULL || list->head->count == UBLOCK_CAP) {
+        struct UBlock *block = newBlock(list->head);
+        if (block == NULL) {
+            struct UPos none = { NULL, 0 };
+            return none;
+        }
+        list->head = block;
+    }
+
+    return insertAt(list->head, 0, data);
+}
+
+struct UPos addAfterUList(struct UList *list, struct UPos prevPos, void *data)
+{
+    if (prevPos.block == NULL)
+        return addFrontUList(list, data);
+
+    struct UBlock *block = prevPos.block;
+    size_t index = prevPos.index + 1;
+
+    if (block->count < UBLOCK_CAP)
+        return insertAt(block, index, data);
+
+    // The block is full.  Appending right after it goes into a fresh
+    // block (so that building a list front to back packs every block
+    // full); otherwise split the block in half and insert into
+    // whichever half the position falls in.
+    struct UBlock *next = newBlock(block->next);
+    if (next == NULL) {
+        struct UPos none = { NULL, 0 };
+        return none;
+    }
+    block->next = next;
+
+    if (index == UBLOCK_CAP)
+        return insertAt(next, 0, data);
+
+    size_t half = UBLOCK_CAP / 2;
+    memcpy(next->data, &block->data[half],
+        (UBLOCK_CAP - half) * sizeof(void *));
+    next->count = UBLOCK_CAP - half;
+    block->count = half;
+
+    if (index <= half)
+        return insertAt(block, index, data);
+    else
+        return insertAt(next, index - half, data);
+}
+
+void *popFrontUList(struct UList *list)
+{
+    struct UBlock *block = list->head;
+    if (block == NULL)
+        return NULL;
+
+    void *data = block->data[0];
+    block->count--;
+    memmove(&block->data[0], &block->data[1], block->count * sizeof(void *));
+
+    if (block->count == 0) {
+        list->head = block->next;
+        free(block);
+    }
+    return data;
+}
+
+void traverseUList(struct UList *list, void (*f)(void *))
+{
+    for (struct UBlock *block = list->head; block; block = block->next) {
+        for (size_t i = 0; i < block->count; i++)
+            f(block->data[i]);
+    }
+}
+
+struct UPos findUList(struct UList *list, const void *dataSought,
+    int (*compar)(const void *, const void *))
+{
+    for (struct UBlock *block = list->head; block; block = block->next) {
+        for (size_t i = 0; i < block->count; i++) {
+            if (compar(dataSought, block->data[i]) == 0) {
+                struct UPos pos = { block, i };
+                return pos;
+            }
+        }
+    }
+
+    struct UPos none = { NULL, 0 };
+    return none;
+}
+
+void reverseUList(struct UList *list)
+{
+    struct UBlock *prv = NULL;
+    struct UBlock *cur = list->head;
+    struct UBlock *nxt;
+
+    while (cur) {
+        // reverse the items within the block
+        for (size_t i = 0, j = cur->count; i + 1 < j; i++, j--) {
+            void *tmp = cur->data[i];
+            cur->data[i] = cur->data[j - 1];
+            cur->data[j - 1] = tmp;
+        }
+
+        nxt = cur->next;
+        cur->next = prv;
+        prv = cur;
+        cur = nxt;
+    }
+
+    list->head = prv;
+}
+
+void removeAllUList(struct UList *list)
+{
+    struct UBlock *block = list->head;
+    while (block) {
+        struct UBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    list->head = NULL;
+}
@@ -0,0 +1,129 @@
+#ifndef _MYULIST_H_
+#define _MYULIST_H_
+
+#include <stddef.h>
+
+/*
+ * An unrolled linked list.
+ *
+ * Instead of one data pointer per node, each block holds an array of
+ * up to UBLOCK_CAP data pointers.  Traversal then walks memory that is
+ * mostly contiguous, costing one cache miss per block rather than one
+ * per element, while insertion and removal keep list semantics.
+ *
+ * Blocks are UBLOCK_SIZE bytes and aligned on a cache line boundary.
+ */
+
+#define UBLOCK_SIZE 128
+
+#define UBLOCK_CAP ((UBLOCK_SIZE - 2 * sizeof(void *)) / sizeof(void *))
+
+/*
+ * A block in an unrolled list.
+ * 'data[0]' through 'data[count - 1]' are the items in the block.
+ */
+struct UBlock {
+    struct UBlock *next;
+    size_t count;
+    void *data[UBLOCK_CAP];
+};
+
+/*
+ * An unrolled linked list.
+ * 'head' points to the first block in the list.
+ */
+struct UList {
+    struct UBlock *head;
+};
+
+/*
+ * The position of an item in an unrolled list: the block that holds it
+ * and its index in that block.  This plays the role that a struct Node
+ * pointer plays in mylist.h; a position whose 'block' is NULL means
+ * "no item".
+ *
+ * Any insertion or removal may move items between blocks, so a
+ * position is only valid until the list is next modified.  The one
+ * exception is the position returned by addAfterUList(), which is
+ * meant to be passed right back to it.
+ */
+struct UPos {
+    struct UBlock *block;
+    size_t index;
+};
+
+/*
+ * Initialize an empty unrolled list.
+ */
+static inline void initUList(struct UList *list)
+{
+    list->head = 0;
+}
+
+/*
+ * Returns 1 if the unrolled list is empty, 0 otherwise.
+ */
+static inline int isEmptyUList(struct UList *list)
+{
+    return (list->head == 0);
+}
+
+/*
+ * Returns the data pointer stored at 'pos'.
+ */
+static inline void *dataAtUPos(struct UPos pos)
+{
+    return pos.block->data[pos.index];
+}
+
+/*
+ * Add the data pointer to the front of the list.
+ *
+ * Returns the position of the new item, whose 'block' is NULL if a new
+ * block could not be allocated.
+ */
+struct UPos addFrontUList(struct UList *list, void *data);
+
+/*
+ * Add the data pointer right after the item at 'prevPos'.  If
+ * 'prevPos.block' is NULL, this function is equivalent to
+ * addFrontUList().
+ *
+ * Returns the position of the new item, whose 'block' is NULL if a new
+ * block could not be allocated.
+ */
+struct UPos addAfterUList(struct UList *list, struct UPos prevPos, void *data);
+
+/*
+ * Remove the first item from the list and return its data pointer.
+ * Returns NULL if the list is empty.
+ */
+void *popFrontUList(struct UList *list);
+
+/*
+ * Traverse the list, calling f() with each data item.
+ */
+void traverseUList(struct UList *list, void (*f)(void *));
+
+/*
+ * Traverse the list, comparing each data item with 'dataSought' using
+ * 'compar' function, which returns 0 on a match.
+ *
+ * Returns the position of the first matching item; its 'block' is NULL
+ * if not found.
+ */
+struct UPos findUList(struct UList *list, const void *dataSought,
+    int (*compar)(const void *, const void *));
+
+/*
+ * Reverse the list, by reversing the order of the blocks and of the
+ * items within each block.  No memory is allocated.
+ */
+void reverseUList(struct UList *list);
+
+/*
+ * Remove all items from the list, deallocating its blocks.
+ */
+void removeAllUList(struct UList *list);
+
+#endif /* #ifndef _MYULIST_H_ */
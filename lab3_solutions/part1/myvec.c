@@ -0,0 +1,120 @@
+/*
+ * myvec.c
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "myvec.h"
+
+#define VEC_MIN_CAPACITY 16
+
+int reserveVec(struct Vec *vec, size_t capacity)
+{
+    if (capacity <= vec->capacity)
+        return 0;
+
+    char *items = (char *)realloc(vec->items, capacity * vec->elemSize);
+    if (items == NULL)
+        return -1;
+
+    vec->items = items;
+    vec->capacity = capacity;
+    return 0;
+}
+
+// Return a pointer to a new, uninitialized element at the end of the
+// vector, doubling the capacity if it is full.
+static char *grow(struct Vec *vec)
+{
+    if (vec->length == vec->capacity) {
+        size_t capacity = vec->capacity ? vec->capacity * 2 : VEC_MIN_CAPACITY;
+        if (reserveVec(vec, capacity) < 0)
+            return NULL;
+    }
+
+    return vec->items + vec->length++ * vec->elemSize;
+}
+
+int pushVec(struct Vec *vec, void *data)
+{
+    char *p = grow(vec);
+    if (p == NULL)
+        return -1;
+
+    *(void **)p = data;
+    return 0;
+}
+
+void *pushRecVec(struct Vec *vec, const void *rec)
+{
+    char *p = grow(vec);
+    if (p == NULL)
+        return NULL;
+
+    memcpy(p, rec, vec->elemSize);
+    return p;
+}
+
+int appendRecsVec(struct Vec *vec, const void *recs, size_t n)
+{
+    if (n == 0)
+        return 0;
+
+    // grow geometrically, so that appending a little at a time still
+    // takes amortized O(1) time per record
+    if (vec->length + n > vec->capacity) {
+        size_t capacity = vec->capacity ? vec->capacity * 2 : VEC_MIN_CAPACITY;
+        if (capacity < vec->length + n)
+            capacity = vec->length + n;
+        if (reserveVec(vec, capacity) < 0)
+            return -1;
+    }
+
+    memcpy(vec->items + vec->length * vec->elemSize, recs, n * vec->elemSize);
+    vec->length += n;
+    return 0;
+}
+
+void traverseVec(struct Vec *vec, void (*f)(void *))
+{
+    for (size_t i = 0; i < vec->length; i++)
+        f(vecAt(vec, i));
+}
+
+size_t findVec(struct Vec *vec, const void *dataSought,
+    int (*compar)(const void *, const void *))
+{
+    for (size_t i = 0; i < vec->length; i++) {
+        if (compar(dataSought, vecAt(vec, i)) == 0)
+            return i;
+    }
+    return VEC_NOT_FOUND;
+}
+
+void reverseVec(struct Vec *vec)
+{
+    if (vec->length < 2)
+        return;
+
+    char *lo = vec->items;
+    char *hi = vec->items + (vec->length - 1) * vec->elemSize;
+
+    // swap the elements byte by byte, so records of any size work
+    while (lo < hi) {
+        for (size_t k = 0; k < vec->elemSize; k++) {
+            char tmp = lo[k];
+            lo[k] = hi[k];
+            hi[k] = tmp;
+        }
+        lo += vec->elemSize;
+        hi -= vec->elemSize;
+    }
+}
+
+void freeVec(struct Vec *vec)
+{
+    free(vec->items);
+    vec->items = NULL;
+    vec->length = 0;
+    vec->capacity = 0;
+}
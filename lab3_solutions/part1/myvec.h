@@ -0,0 +1,159 @@
+#ifndef _MYVEC_H_
+#define _MYVEC_H_
+
+#include <stddef.h>
+
+/*
+ * A growable array.
+ *
+ * A vector works in one of two modes:
+ *
+ *   - pointer mode (initVec()): each element is a data pointer, just
+ *     like the 'data' field of a struct Node.  The vector does not
+ *     manage the lifetime of the objects the pointers point to.
+ *
+ *   - record mode (initRecVec()): each element is a fixed-size record
+ *     copied into the vector, so all records live in one contiguous
+ *     allocation.
+ *
+ * 'items' points to 'capacity' elements of 'elemSize' bytes each, of
+ * which the first 'length' are in use.
+ *
+ * Appending takes amortized O(1) time, since the capacity doubles
+ * whenever it runs out.  Growing the vector may move 'items', which
+ * invalidates any pointer into a record-mode vector.
+ */
+struct Vec {
+    char *items;
+    size_t length;
+    size_t capacity;
+    size_t elemSize;
+    int recMode;
+};
+
+/*
+ * Returned by findVec() when there is no match.
+ */
+#define VEC_NOT_FOUND ((size_t)-1)
+
+/*
+ * Initialize an empty vector of data pointers.
+ */
+static inline void initVec(struct Vec *vec)
+{
+    vec->items = 0;
+    vec->length = 0;
+    vec->capacity = 0;
+    vec->elemSize = sizeof(void *);
+    vec->recMode = 0;
+}
+
+/*
+ * Initialize an empty vector of records that are 'recSize' bytes each.
+ */
+static inline void initRecVec(struct Vec *vec, size_t recSize)
+{
+    initVec(vec);
+    vec->elemSize = recSize;
+    vec->recMode = 1;
+}
+
+/*
+ * Returns the number of elements in the vector.
+ */
+static inline size_t vecLength(const struct Vec *vec)
+{
+    return vec->length;
+}
+
+/*
+ * Returns element 'i' of the vector: the data pointer in pointer mode,
+ * or a pointer to the record in record mode.  'i' must be less than
+ * the vector's length.
+ */
+static inline void *vecAt(const struct Vec *vec, size_t i)
+{
+    char *p = vec->items + i * vec->elemSize;
+    return vec->recMode ? (void *)p : *(void **)p;
+}
+
+/*
+ * Remove all elements, keeping the storage for reuse.
+ */
+static inline void clearVec(struct Vec *vec)
+{
+    vec->length = 0;
+}
+
+/*
+ * Make room for at least 'capacity' elements, so that appending up to
+ * that many elements will not reallocate.
+ *
+ * Returns 0 on success and -1 on failure, in which case the vector is
+ * unchanged.
+ */
+int reserveVec(struct Vec *vec, size_t capacity);
+
+/*
+ * Append a data pointer to a pointer-mode vector.
+ *
+ * Returns 0 on success and -1 on failure.
+ */
+int pushVec(struct Vec *vec, void *data);
+
+/*
+ * Append a copy of the record pointed to by 'rec' to a record-mode
+ * vector.
+ *
+ * Returns a pointer to the copy on success and NULL on failure.
+ */
+void *pushRecVec(struct Vec *vec, const void *rec);
+
+/*
+ * Append copies of the 'n' records at 'recs' to a record-mode vector,
+ * growing it at most once.
+ *
+ * Returns 0 on success and -1 on failure, in which case the vector is
+ * unchanged.
+ */
+int appendRecsVec(struct Vec *vec, const void *recs, size_t n);
+
+/*
+ * Shorten the vector to its first 'length' elements, keeping the
+ * storage for reuse.  A vector already that short is left alone.
+ */
+static inline void truncateVec(struct Vec *vec, size_t length)
+{
+    if (length < vec->length)
+        vec->length = length;
+}
+
+/*
+ * Traverse the vector in order, calling f() with each element as
+ * returned by vecAt().
+ */
+void traverseVec(struct Vec *vec, void (*f)(void *));
+
+/*
+ * Traverse the vector, comparing each element (as returned by vecAt())
+ * with 'dataSought' using 'compar' function, which returns 0 on a
+ * match.
+ *
+ * Returns the index of the first matching element, VEC_NOT_FOUND if
+ * not found.
+ */
+size_t findVec(struct Vec *vec, const void *dataSought,
+    int (*compar)(const void *, const void *));
+
+/*
+ * Reverse the order of the elements in place.
+ */
+void reverseVec(struct Vec *vec);
+
+/*
+ * Deallocate the vector's storage, leaving it empty.  The vector keeps
+ * its mode and can be used again.
+ */
+void freeVec(struct Vec *vec);
+
+#endif /* #ifndef _MYVEC_H_ */
@@ -15,16 +15,25 @@
  *  So if CONFIG_MDB_CS3157 is defined, then we assume we are compiling to
  *  mdb-add-cs3157; if CONFIG_MDB_CS3157 isn't defined, then we do not hardcode
  *  the mdb path and assume we are compiling to mdb-add.
+ *
+ *  Either way, the -b flag selects batch mode: instead of prompting for one
+ *  name and msg, read name and msg lines in pairs from stdin until EOF, and
+ *  append all of those records to the database in a single write.
+ *
+ *  The database is never read.  Records are fixed-size, so the number of
+ *  the next record follows from the size of the file.
  */
 
+#define _POSIX_C_SOURCE 200809L
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
-#include <mylist.h>
+#include <myvec.h>
 
 #include "mdb.h"
 
@@ -43,8 +52,46 @@ static void sanitize(char *s)
     }
 }
 
+/*
+ * Read a line from stdin into 'field', which is 'size' bytes long,
+ * truncating it to fit and removing the newline.  Returns -1 on EOF.
+ */
+static int readField(char *field, size_t size)
+{
+    char line[1024];
+
+    if (fgets(line, sizeof(line), stdin) == NULL)
+        return -1;
+
+    // must null-terminate the string manually after strncpy().
+    strncpy(field, line, size - 1);
+    field[size - 1] = '\0';
+
+    // if newline is there, remove it.
+    size_t len = strlen(field);
+    if (len > 0 && field[len - 1] == '\n')
+        field[len - 1] = '\0';
+
+    // user might have typed more than sizeof(line) - 1 characters in line;
+    // continue fgets()ing until we encounter a newline.
+    while (line[strlen(line) - 1] != '\n' && fgets(line, sizeof(line), stdin))
+        ;
+
+    // remove non-printable chars from the string
+    sanitize(field);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
+    // -b selects batch mode
+    int batch = 0;
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        batch = 1;
+        argc--;
+        argv++;
+    }
+
     /*
      * open the database file
      */
@@ -54,7 +101,7 @@ int main(int argc, char **argv)
     // mdb path is argv[1]
 
     if (argc != 2) {
-        fprintf(stderr, "%s\n", "usage: mdb-add <database_file>");
+        fprintf(stderr, "%s\n", "usage: mdb-add [-b] <database_file>");
         exit(1);
     }
 
@@ -64,7 +111,7 @@ int main(int argc, char **argv)
     // the CONFIG_MDB_CS3157 macro expands to hard-coded the mdb path.
 
     if (argc != 1) {
-        fprintf(stderr, "%s\n", "usage: mdb-add-cs3157");
+        fprintf(stderr, "%s\n", "usage: mdb-add-cs3157 [-b]");
         exit(1);
     }
 
@@ -79,130 +126,95 @@ int main(int argc, char **argv)
     umask(S_IWGRP | S_IWOTH);
 #endif
 
-    // open for append & read, binary mode
-    FILE *fp = fopen(filename, "a+b");
+    // open for append, binary mode
+    FILE *fp = fopen(filename, "ab");
     if (fp == NULL)
         die(filename);
 
     /*
-     * load the database file into a linked list
+     * number the new records after the ones already in the file
      */
 
-    struct List list;
-    initList(&list);
-
-    // we need to call fseek() to read from the beginning
-    fseek(fp, 0, SEEK_SET);
-
-    int loaded = loadmdb(fp, &list);
-    if (loaded < 0)
-        die("loadmdb");
-
-    // count the number of entries and keep a pointer to the last node
-    struct Node *lastNode = list.head;
-    int recNo = 0;
-    while (lastNode) {
-        recNo++;
-        if (lastNode->next)
-            lastNode = lastNode->next;
-        else
-            break;
-    }
-
-    /*
-     * read name
-     */
-
-    struct MdbRec r;
-    char line[1024];
-    size_t last;
-
-    printf("name please (will truncate to %ld chars): ", sizeof(r.name) - 1);
-    if (fgets(line, sizeof(line), stdin) == NULL) {
-        fprintf(stderr, "%s\n", "could not read name");
-        exit(1);
-    }
-
-    // must null-terminate the string manually after strncpy().
-    strncpy(r.name, line, sizeof(r.name) - 1);
-    r.name[sizeof(r.name) - 1] = '\0';
-
-    // if newline is there, remove it.
-    last = strlen(r.name) - 1;
-    if (r.name[last] == '\n')
-        r.name[last] = '\0';
-
-    // user might have typed more than sizeof(line) - 1 characters in line;
-    // continue fgets()ing until we encounter a newline.
-    while (line[strlen(line) - 1] != '\n' && fgets(line, sizeof(line), stdin))
-        ;
-
-    /*
-     * read msg
-     */
+    struct stat st;
+    if (fstat(fileno(fp), &st) < 0)
+        die(filename);
 
-    printf("msg please (will truncate to %ld chars): ", sizeof(r.msg) - 1);
-    if (fgets(line, sizeof(line), stdin) == NULL) {
-        fprintf(stderr, "%s\n", "could not read msg");
+    // a partial record would misalign everything we append after it
+    if (st.st_size % sizeof(struct MdbRec) != 0) {
+        fprintf(stderr, "%s: not a valid database file\n", filename);
         exit(1);
     }
 
-    // must null-terminate the string manually after strncpy().
-    strncpy(r.msg, line, sizeof(r.msg) - 1);
-    r.msg[sizeof(r.msg) - 1] = '\0';
-
-    // if newline is there, remove it.
-    last = strlen(r.msg) - 1;
-    if (r.msg[last] == '\n')
-        r.msg[last] = '\0';
-
-    // user might have typed more than sizeof(line) - 1 characters in line;
-    // continue fgets()ing until we encounter a newline.
-    while (line[strlen(line) - 1] != '\n' && fgets(line, sizeof(line), stdin))
-        ;
+    int recNo = (int)(st.st_size / sizeof(struct MdbRec));
 
     /*
-     * add the record to the in-memory database
+     * read the records
      */
 
-    struct MdbRec *rec = (struct MdbRec *)malloc(sizeof(r));
-    if (!rec)
-        die("malloc failed");
+    struct Vec recs;
+    initRecVec(&recs, sizeof(struct MdbRec));
 
-    memcpy(rec, &r, sizeof(r));
+    struct MdbRec r;
 
-    struct Node *newNode = addAfter(&list, lastNode, rec);
-    if (newNode == NULL)
-        die("addAfter() failed");
+    if (batch) {
+        // read name and msg lines in pairs; a name without a msg is dropped
+        while (readField(r.name, sizeof(r.name)) == 0
+            && readField(r.msg, sizeof(r.msg)) == 0) {
+            if (pushRecVec(&recs, &r) == NULL)
+                die("malloc failed");
+        }
+    } else {
+        printf("name please (will truncate to %ld chars): ", sizeof(r.name) - 1);
+        if (readField(r.name, sizeof(r.name)) < 0) {
+            fprintf(stderr, "%s\n", "could not read name");
+            exit(1);
+        }
+
+        printf("msg please (will truncate to %ld chars): ", sizeof(r.msg) - 1);
+        if (readField(r.msg, sizeof(r.msg)) < 0) {
+            fprintf(stderr, "%s\n", "could not read msg");
+            exit(1);
+        }
+
+        if (pushRecVec(&recs, &r) == NULL)
+            die("malloc failed");
+    }
 
-    recNo++;
+    // see if fgets() produced error
+    if (ferror(stdin))
+        die("stdin");
 
     /*
-     * write the name and msg to the database file
+     * append all the records to the database file in one write, and
+     * make sure they have reached the disk before we confirm them
      */
 
-    // remove non-printable chars from the strings
-    sanitize(r.name);
-    sanitize(r.msg);
+    size_t n = vecLength(&recs);
 
-    if (fwrite(&r, sizeof(r), 1, fp) < 1)
+    if (n > 0 && fwrite(vecAt(&recs, 0), sizeof(struct MdbRec), n, fp) < n)
         die("fwrite() record");
 
     if (fflush(fp) != 0)
         die("fflush() file");
 
+    if (fsync(fileno(fp)) != 0)
+        die("fsync() file");
+
     /*
      * print confirmation
      */
 
-    printf("%4d: {%s} said {%s}\n", recNo, rec->name, rec->msg);
+    for (size_t i = 0; i < n; i++) {
+        struct MdbRec *rec = (struct MdbRec *)vecAt(&recs, i);
+        printf("%4d: {%s} said {%s}\n", ++recNo, rec->name, rec->msg);
+    }
     fflush(stdout);
 
     /*
      * clean up and exit
      */
 
-    freemdb(&list);
+    freeVec(&recs);
     fclose(fp);
     return 0;
 }
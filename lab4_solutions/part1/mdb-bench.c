@@ -0,0 +1,217 @@
+/*
+ * mdb-bench.c
+ *
+ *  Compares the ways of scanning a database for a key, without the
+ *  trigram index:
+ *
+ *    - the linked list that loadmdb() builds, with strstr();
+ *    - the struct MdbRec array that mapmdb() maps, with strstr();
+ *    - the same array, with the scanFields() kernel (myscan.h);
+ *    - the columns that loadmdbcols() builds, with scanmdbcols(), which
+ *      uses the same kernel.
+ *
+ *  Each key is looked up CONFIG_NUM_ROUNDS times on each path; the best
+ *  round counts.  Generate a database to run it on with 'mdb-add -b'.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <mylist.h>
+#include <myscan.h>
+
+#include "mdb.h"
+
+/** Keys to look up: the empty key matches everything, and the rest go
+ *  from short and common to long and rare. */
+#define CONFIG_KEYS { "", "a", "ab", "abc", "hello", "zzzzz" }
+
+/** Number of times each measurement is repeated; the best run counts. */
+#define CONFIG_NUM_ROUNDS 5
+
+// Convert timespec to double-precision floating point number, in nanoseconds.
+#define ts2double(ts) ((double)(ts).tv_sec * 1000000000. + (double)(ts).tv_nsec)
+
+static void die(const char *message)
+{
+    perror(message);
+    exit(1);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        die("clock_gettime");
+    return ts2double(ts);
+}
+
+static size_t scanList(struct IList *list, const char *key)
+{
+    size_t found = 0;
+
+    for (struct Link *link = list->head; link; link = link->next) {
+        struct MdbRec *rec = mdbRecOf(link);
+        if (strstr(rec->name, key) || strstr(rec->msg, key))
+            found++;
+    }
+    return found;
+}
+
+static size_t scanArray(const struct MdbMap *db, const char *key)
+{
+    size_t found = 0;
+
+    for (size_t i = 0; i < db->count; i++) {
+        const struct MdbRec *rec = &db->recs[i];
+        if (strstr(rec->name, key) || strstr(rec->msg, key))
+            found++;
+    }
+    return found;
+}
+
+static size_t scanArrayFields(const struct MdbMap *db, const char *key,
+    unsigned char *hits)
+{
+    size_t found = 0;
+
+    if (db->count == 0)
+        return 0;
+
+    memset(hits, 0, db->count);
+    scanFields(db->recs[0].name, sizeof(struct MdbRec),
+        sizeof(db->recs[0].name), db->count, key, hits);
+    scanFields(db->recs[0].msg, sizeof(struct MdbRec),
+        sizeof(db->recs[0].msg), db->count, key, hits);
+
+    for (size_t i = 0; i < db->count; i++)
+        found += hits[i];
+    return found;
+}
+
+static size_t scanColumns(const struct MdbColumns *cols, const char *key,
+    struct Vec *matches)
+{
+    clearVec(matches);
+    if (scanmdbcols(cols, key, 0, cols->count, matches) < 0)
+        die("scanmdbcols");
+    return vecLength(matches);
+}
+
+// Print the best of 'times' as nanoseconds per record.
+static void report(const char *what, const char *key, size_t n,
+    size_t found, double *times)
+{
+    double best = times[0];
+    for (int round = 1; round < CONFIG_NUM_ROUNDS; round++)
+        best = times[round] < best ? times[round] : best;
+
+    printf("%-8s key %-7s %9zu matches %8.3f ns/rec\n",
+        what, key, found, best / (n ? n : 1));
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "%s\n", "usage: mdb-bench <database_file>");
+        exit(1);
+    }
+
+    char *filename = argv[1];
+    double start;
+
+    /*
+     * load the database all three ways
+     */
+
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL)
+        die(filename);
+
+    struct IList list;
+    initIList(&list);
+
+    start = now();
+    if (loadmdb(fp, &list) < 0)
+        die("loadmdb");
+    printf("%-24s %12.3f ms\n", "loadmdb()", (now() - start) / 1e6);
+    fclose(fp);
+
+    struct MdbMap db;
+    start = now();
+    if (mapmdb(filename, &db) < 0)
+        die(filename);
+    printf("%-24s %12.3f ms\n", "mapmdb()", (now() - start) / 1e6);
+
+    struct MdbColumns cols;
+    start = now();
+    if (loadmdbcols(&db, &cols) < 0)
+        die("loadmdbcols");
+    printf("%-24s %12.3f ms\n", "loadmdbcols()", (now() - start) / 1e6);
+
+    printf("%zu records, %s kernel\n\n", db.count,
+        scanKernelName(bestScanKernel()));
+
+    /*
+     * time the scans
+     */
+
+    const char *keys[] = CONFIG_KEYS;
+    double times[CONFIG_NUM_ROUNDS];
+    size_t found[4] = { 0 };
+
+    struct Vec matches;
+    initRecVec(&matches, sizeof(uint32_t));
+
+    unsigned char *hits = (unsigned char *)malloc(db.count + 1);
+    if (hits == NULL)
+        die("malloc");
+
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+        for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+            start = now();
+            found[0] = scanList(&list, keys[k]);
+            times[round] = now() - start;
+        }
+        report("list", keys[k], db.count, found[0], times);
+
+        for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+            start = now();
+            found[1] = scanArray(&db, keys[k]);
+            times[round] = now() - start;
+        }
+        report("array", keys[k], db.count, found[1], times);
+
+        for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+            start = now();
+            found[2] = scanArrayFields(&db, keys[k], hits);
+            times[round] = now() - start;
+        }
+        report("array+k", keys[k], db.count, found[2], times);
+
+        for (int round = 0; round < CONFIG_NUM_ROUNDS; round++) {
+            start = now();
+            found[3] = scanColumns(&cols, keys[k], &matches);
+            times[round] = now() - start;
+        }
+        report("columns", keys[k], db.count, found[3], times);
+
+        // all paths must agree
+        if (found[0] != found[1] || found[1] != found[2] || found[2] != found[3]) {
+            fprintf(stderr, "scans disagree on key \"%s\"\n", keys[k]);
+            exit(1);
+        }
+        printf("\n");
+    }
+
+    free(hits);
+    freeVec(&matches);
+    freemdbcols(&cols);
+    unmapmdb(&db);
+    freemdb(&list);
+    return 0;
+}
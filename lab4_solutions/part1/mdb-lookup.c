@@ -2,6 +2,7 @@
  * mdb-lookup.c
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,34 +19,107 @@ static void die(const char *message)
     exit(1);
 }
 
+static void printMatches(const struct MdbColumns *cols, const struct Vec *matches)
+{
+    for (size_t i = 0; i < vecLength(matches); i++) {
+        uint32_t recNo = *(uint32_t *)vecAt(matches, i);
+
+        printf("%4d: {%.*s} said {%.*s}\n", (int)recNo + 1,
+            cols->nameLens[recNo], cols->names[recNo],
+            cols->msgLens[recNo], cols->msgs[recNo]);
+    }
+}
+
+/*
+ * Look up all the keys in 'keys', a record-mode vector of
+ * char[KeyMax + 1], with one matchmdbbatch(), and print the results
+ * just as if they had been looked up one by one.
+ */
+static void lookupBatch(const struct MdbColumns *cols,
+    const struct TrigramIndex *index, const struct Vec *keys, int nthreads)
+{
+    int nkeys = (int)vecLength(keys);
+    const char **ptrs = (const char **)malloc((nkeys ? nkeys : 1) * sizeof(char *));
+    struct Vec *matches = (struct Vec *)malloc((nkeys ? nkeys : 1) * sizeof(struct Vec));
+    if (ptrs == NULL || matches == NULL)
+        die("malloc");
+
+    for (int k = 0; k < nkeys; k++) {
+        ptrs[k] = (const char *)vecAt(keys, k);
+        initRecVec(&matches[k], sizeof(uint32_t));
+    }
+
+    if (matchmdbbatch(cols, index, ptrs, nkeys, matches, nthreads) < 0)
+        die("matchmdbbatch");
+
+    for (int k = 0; k < nkeys; k++) {
+        printMatches(cols, &matches[k]);
+        printf("\nlookup: ");
+        freeVec(&matches[k]);
+    }
+    fflush(stdout);
+
+    free(ptrs);
+    free(matches);
+}
+
 int main(int argc, char **argv)
 {
     /*
      * open the database file specified in the command line
      */
 
-    if (argc != 2) {
-        fprintf(stderr, "%s\n", "usage: mdb-lookup <database_file>");
+    // -j N scans the records on N threads, -b reads all the keys before
+    // looking them up together, and -w writes the index to its sidecar
+    // file if it had to be built
+    int nthreads = 1, batch = 0, save = 0;
+    for (;;) {
+        if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+            nthreads = atoi(argv[2]);
+            argc -= 2;
+            argv += 2;
+        } else if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+            batch = 1;
+            argc--;
+            argv++;
+        } else if (argc > 1 && strcmp(argv[1], "-w") == 0) {
+            save = 1;
+            argc--;
+            argv++;
+        } else {
+            break;
+        }
+    }
+
+    if (argc != 2 || nthreads < 1) {
+        fprintf(stderr, "%s\n", "usage: mdb-lookup [-j N] [-b] [-w] <database_file>");
         exit(1);
     }
 
     char *filename = argv[1];
-    FILE *fp = fopen(filename, "rb");
-    if (fp == NULL)
-        die(filename);
 
     /*
-     * read all records into memory
+     * map the database into memory
      */
 
-    struct List list;
-    initList(&list);
+    struct MdbMap db;
+    if (mapmdb(filename, &db) < 0)
+        die(filename);
+
+    // Without an index, lookups still work; they just scan every record.
+    struct TrigramIndex index;
+    indexmdb(filename, &db, &index, save);
 
-    int loaded = loadmdb(fp, &list);
-    if (loaded < 0)
-        die("loadmdb");
+    // lookups scan the records in columnar form, so the mapping is no
+    // longer needed once they are loaded
+    struct MdbColumns cols;
+    if (loadmdbcols(&db, &cols) < 0)
+        die("loadmdbcols");
+    unmapmdb(&db);
 
-    fclose(fp);
+    struct Vec matches, keys;
+    initRecVec(&matches, sizeof(uint32_t));
+    initRecVec(&keys, KeyMax + 1);
 
     /*
      * lookup loop
@@ -81,18 +155,18 @@ int main(int argc, char **argv)
          * search with key
          */
 
-        // traverse the list, printing out the matching records
-        struct Node *node = list.head;
-        int recNo = 1;
-        while (node) {
-            struct MdbRec *rec = (struct MdbRec *)node->data;
+        // in batch mode, save the key for later
+        if (batch) {
+            if (pushRecVec(&keys, key) == NULL)
+                die("pushRecVec");
+            continue;
+        }
 
-            if (strstr(rec->name, key) || strstr(rec->msg, key))
-                printf("%4d: {%s} said {%s}\n", recNo, rec->name, rec->msg);
+        // find the matching records and print them out
+        if (matchmdb(&cols, &index, key, &matches, nthreads) < 0)
+            die("matchmdb");
 
-            node = node->next;
-            recNo++;
-        }
+        printMatches(&cols, &matches);
 
         printf("\nlookup: ");
         fflush(stdout);
@@ -102,10 +176,16 @@ int main(int argc, char **argv)
     if (ferror(stdin))
         die("stdin");
 
+    if (batch)
+        lookupBatch(&cols, &index, &keys, nthreads);
+
     /*
      * clean up and quit
      */
 
-    freemdb(&list);
+    freeVec(&matches);
+    freeVec(&keys);
+    freemdbcols(&cols);
+    freeTrigramIndex(&index);
     return 0;
 }
@@ -2,37 +2,73 @@
  * mdb.c
  */
 
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <myaho.h>
 #include <mylist.h>
+#include <myscan.h>
+#include <mytrigram.h>
 
 #include "mdb.h"
 
-int loadmdb(FILE *fp, struct List *dest)
+int loadmdb(FILE *fp, struct IList *dest)
 {
     /*
      * read all records into memory
      */
 
     struct MdbRec r;
-    struct Node *node = NULL;
     int count = 0;
 
     while (fread(&r, sizeof(r), 1, fp) == 1) {
 
-        // allocate memory for a new record and copy into it the one
-        // that was just read from the database.
-        struct MdbRec *rec = (struct MdbRec *)malloc(sizeof(r));
-        if (!rec)
+        // allocate memory for a new record, which carries its own list
+        // link, and copy into it the one that was just read from the
+        // database.
+        struct MdbNode *mnode = (struct MdbNode *)malloc(sizeof(*mnode));
+        if (!mnode)
             return -1;
 
-        memcpy(rec, &r, sizeof(r));
+        memcpy(&mnode->rec, &r, sizeof(r));
 
-        // add the record to the linked list.
-        node = addAfter(dest, node, rec);
-        if (node == NULL)
+        // add the record to the end of the linked list.
+        addBackLink(dest, &mnode->link);
+
+        count++;
+    }
+
+    // see if fread() produced error
+    if (ferror(fp))
+        return -1;
+
+    return count;
+}
+
+void freemdb(struct IList *list)
+{
+    // free all the records; the links go with them
+    struct Link *link;
+    while ((link = popFrontLink(list)) != NULL)
+        free(containerOf(link, struct MdbNode, link));
+}
+
+int loadmdbvec(FILE *fp, struct Vec *dest)
+{
+    struct MdbRec r;
+    int count = 0;
+
+    while (fread(&r, sizeof(r), 1, fp) == 1) {
+        // the vector keeps its own copy of the record
+        if (pushRecVec(dest, &r) == NULL)
             return -1;
 
         count++;
@@ -45,9 +81,338 @@ int loadmdb(FILE *fp, struct List *dest)
     return count;
 }
 
-void freemdb(struct List *list)
+int mapmdb(const char *filename, struct MdbMap *map)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    map->recs = NULL;
+    map->count = (size_t)st.st_size / sizeof(struct MdbRec);
+    map->size = map->count * sizeof(struct MdbRec);
+
+    // mmap() refuses zero-length mappings
+    if (map->size > 0) {
+        void *p = mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        map->recs = (const struct MdbRec *)p;
+    }
+
+    // the mapping stays valid after the file is closed
+    close(fd);
+    return 0;
+}
+
+void unmapmdb(struct MdbMap *map)
+{
+    if (map->recs)
+        munmap((void *)map->recs, map->size);
+    map->recs = NULL;
+    map->count = 0;
+    map->size = 0;
+}
+
+int indexmdb(const char *filename, const struct MdbMap *db,
+    struct TrigramIndex *index, int save)
+{
+    // the sidecar is named after the database file
+    size_t len = strlen(filename);
+    char *sidecar = (char *)malloc(len + sizeof(".tri"));
+    if (sidecar == NULL) {
+        initTrigramIndex(index);
+        return -1;
+    }
+    memcpy(sidecar, filename, len);
+    memcpy(sidecar + len, ".tri", sizeof(".tri"));
+
+    initTrigramIndex(index);
+
+    // use the sidecar if it was built from this database, unless too
+    // many records have been added since
+    if (loadTrigramIndex(index, sidecar) == 0
+        && checkTrigramIndex(index, db->recs, db->count, sizeof(struct MdbRec))
+        && db->count - index->count <= index->count / 8) {
+        free(sidecar);
+        return 0;
+    }
+
+    struct TextField fields[] = {
+        { offsetof(struct MdbRec, name), sizeof(db->recs->name) },
+        { offsetof(struct MdbRec, msg), sizeof(db->recs->msg) },
+    };
+
+    if (buildTrigramIndex(index, db->recs, db->count, sizeof(struct MdbRec),
+            fields, 2) < 0) {
+        free(sidecar);
+        return -1;
+    }
+
+    // Failing to save only means the next run builds the index again;
+    // the database may well be in a directory we can't write to.
+    if (save)
+        saveTrigramIndex(index, sidecar);
+
+    free(sidecar);
+    return 0;
+}
+
+int loadmdbcols(const struct MdbMap *db, struct MdbColumns *cols)
+{
+    size_t n = db->count;
+
+    cols->count = 0;
+    cols->names = (char (*)[16])malloc(n * sizeof(*cols->names));
+    cols->msgs = (char (*)[24])malloc(n * sizeof(*cols->msgs));
+    cols->nameLens = (unsigned char *)malloc(n);
+    cols->msgLens = (unsigned char *)malloc(n);
+
+    if (n > 0 && (!cols->names || !cols->msgs || !cols->nameLens || !cols->msgLens)) {
+        freemdbcols(cols);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const struct MdbRec *rec = &db->recs[i];
+
+        memcpy(cols->names[i], rec->name, sizeof(rec->name));
+        memcpy(cols->msgs[i], rec->msg, sizeof(rec->msg));
+        cols->nameLens[i] = (unsigned char)strnlen(rec->name, sizeof(rec->name));
+        cols->msgLens[i] = (unsigned char)strnlen(rec->msg, sizeof(rec->msg));
+    }
+
+    cols->count = n;
+    return 0;
+}
+
+void freemdbcols(struct MdbColumns *cols)
+{
+    free(cols->names);
+    free(cols->msgs);
+    free(cols->nameLens);
+    free(cols->msgLens);
+    memset(cols, 0, sizeof(*cols));
+}
+
+// the saved lengths do as field widths, since no string has a null
+// byte before its length
+static int recMatches(const struct MdbColumns *cols, size_t i,
+    const char *key, size_t klen)
+{
+    return fieldContains(cols->names[i], cols->nameLens[i], key, klen)
+        || fieldContains(cols->msgs[i], cols->msgLens[i], key, klen);
+}
+
+int scanmdbcols(const struct MdbColumns *cols, const char *key,
+    size_t from, size_t to, struct Vec *matches)
+{
+    if (from >= to)
+        return 0;
+
+    size_t n = to - from;
+    unsigned char *hits = (unsigned char *)calloc(n, 1);
+    if (hits == NULL)
+        return -1;
+
+    // scan each column on its own, marking the records that match in
+    // either field
+    scanFields(cols->names[from], sizeof(cols->names[0]),
+        sizeof(cols->names[0]), n, key, hits);
+    scanFields(cols->msgs[from], sizeof(cols->msgs[0]),
+        sizeof(cols->msgs[0]), n, key, hits);
+
+    int found = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t id = (uint32_t)(from + i);
+        if (hits[i]) {
+            if (pushRecVec(matches, &id) == NULL) {
+                free(hits);
+                return -1;
+            }
+            found++;
+        }
+    }
+
+    free(hits);
+    return found;
+}
+
+/*
+ * A slice of the records for one thread to scan, and the vector its
+ * matches go into.
+ */
+struct ScanSlice {
+    const struct MdbColumns *cols;
+    const char *key;
+    size_t from;
+    size_t to;
+    struct Vec matches;
+    int result;
+};
+
+static void *scanSlice(void *arg)
+{
+    struct ScanSlice *slice = (struct ScanSlice *)arg;
+
+    slice->result = scanmdbcols(slice->cols, slice->key, slice->from,
+        slice->to, &slice->matches);
+    return NULL;
+}
+
+int parallelscanmdbcols(const struct MdbColumns *cols, const char *key,
+    size_t from, size_t to, struct Vec *matches, int nthreads)
+{
+    // don't bother with threads for a few pages of records
+    size_t n = from < to ? to - from : 0;
+    size_t maxSlices = n / MDB_SCAN_MIN_SLICE;
+    size_t nslices = (size_t)nthreads < maxSlices ? (size_t)nthreads : maxSlices;
+
+    if (nthreads < 2 || nslices < 2)
+        return scanmdbcols(cols, key, from, to, matches);
+
+    struct ScanSlice *slices =
+        (struct ScanSlice *)malloc(nslices * sizeof(struct ScanSlice));
+    pthread_t *threads = (pthread_t *)malloc(nslices * sizeof(pthread_t));
+
+    if (slices == NULL || threads == NULL) {
+        free(slices);
+        free(threads);
+        return scanmdbcols(cols, key, from, to, matches);
+    }
+
+    // the slices are contiguous and in order, so concatenating their
+    // matches keeps the record numbers in increasing order
+    for (size_t s = 0; s < nslices; s++) {
+        slices[s].cols = cols;
+        slices[s].key = key;
+        slices[s].from = from + s * n / nslices;
+        slices[s].to = from + (s + 1) * n / nslices;
+        initRecVec(&slices[s].matches, sizeof(uint32_t));
+        slices[s].result = 0;
+    }
+
+    // Start a thread for every slice but the first, which we scan
+    // ourselves.  If we can't start a thread, we scan its slice (and
+    // all the ones after it) ourselves too.
+    size_t started = 1;
+    while (started < nslices
+        && pthread_create(&threads[started], NULL, &scanSlice, &slices[started]) == 0)
+        started++;
+
+    scanSlice(&slices[0]);
+    for (size_t s = started; s < nslices; s++)
+        scanSlice(&slices[s]);
+
+    for (size_t s = 1; s < started; s++)
+        pthread_join(threads[s], NULL);
+
+    int found = 0;
+    for (size_t s = 0; s < nslices; s++) {
+        size_t len = vecLength(&slices[s].matches);
+
+        if (found >= 0 && slices[s].result < 0)
+            found = -1;
+        if (found >= 0 && len > 0) {
+            if (appendRecsVec(matches, vecAt(&slices[s].matches, 0), len) < 0)
+                found = -1;
+            else
+                found += (int)len;
+        }
+        freeVec(&slices[s].matches);
+    }
+
+    free(slices);
+    free(threads);
+    return found;
+}
+
+int matchmdb(const struct MdbColumns *cols, const struct TrigramIndex *index,
+    const char *key, struct Vec *matches, int nthreads)
 {
-    // free all the records
-    traverseList(list, &free);
-    removeAllNodes(list);
+    // records past the end of the index have to be scanned
+    size_t covered = index->count < cols->count ? index->count : cols->count;
+    size_t scanFrom = 0;
+    size_t klen = strlen(key);
+
+    clearVec(matches);
+
+    if (findTrigramCandidates(index, key, matches) >= 0) {
+        // keep the candidates that really contain the key
+        uint32_t *ids = vecLength(matches) ? (uint32_t *)vecAt(matches, 0) : NULL;
+        size_t kept = 0;
+
+        for (size_t i = 0; i < vecLength(matches); i++) {
+            if (ids[i] < covered && recMatches(cols, ids[i], key, klen))
+                ids[kept++] = ids[i];
+        }
+        truncateVec(matches, kept);
+        scanFrom = covered;
+    } else {
+        // the key is too short for the index, or we ran out of memory
+        clearVec(matches);
+    }
+
+    if (parallelscanmdbcols(cols, key, scanFrom, cols->count, matches,
+            nthreads) < 0)
+        return -1;
+
+    return (int)vecLength(matches);
+}
+
+int matchmdbbatch(const struct MdbColumns *cols, const struct TrigramIndex *index,
+    const char *const *keys, int nkeys, struct Vec *matches, int nthreads)
+{
+    size_t n = nkeys ? (size_t)nkeys : 1;
+    const char **scanKeys = (const char **)malloc(n * sizeof(char *));
+    struct Vec **scanMatches = (struct Vec **)malloc(n * sizeof(struct Vec *));
+    int nscan = 0, result = -1;
+
+    if (scanKeys == NULL || scanMatches == NULL)
+        goto out;
+
+    // keys the index narrows down are cheaper to look up on their own
+    for (int k = 0; k < nkeys; k++) {
+        clearVec(&matches[k]);
+        if (index->count > 0 && strlen(keys[k]) >= 3) {
+            if (matchmdb(cols, index, keys[k], &matches[k], nthreads) < 0)
+                goto out;
+        } else {
+            scanKeys[nscan] = keys[k];
+            scanMatches[nscan++] = &matches[k];
+        }
+    }
+
+    // nothing to look for, or nothing to look in
+    if (nscan == 0 || cols->count == 0) {
+        result = 0;
+        goto out;
+    }
+
+    // for a single key, the SIMD scan in matchmdb() beats the automaton
+    if (nscan == 1) {
+        result = matchmdb(cols, index, scanKeys[0], scanMatches[0],
+            nthreads) < 0 ? -1 : 0;
+        goto out;
+    }
+
+    // the rest are all matched in one pass over the records
+    struct TextColumn columns[] = {
+        { (const char *)cols->names, sizeof(*cols->names), sizeof(*cols->names) },
+        { (const char *)cols->msgs, sizeof(*cols->msgs), sizeof(*cols->msgs) },
+    };
+    result = matchAhoCorasickColumns(scanKeys, nscan, columns, 2, cols->count,
+        scanMatches);
+
+out:
+    free(scanKeys);
+    free(scanMatches);
+    return result;
 }
@@ -8,13 +8,172 @@
 #include <stdio.h>
 
 #include <mylist.h>
+#include <mytrigram.h>
+#include <myvec.h>
 
 struct MdbRec {
     char name[16];
     char msg[24];
 };
 
-int loadmdb(FILE *fp, struct List *dest);
-void freemdb(struct List *list);
+/*
+ * An in-memory record: the record read from the database file plus the
+ * link that puts it on the database list, in a single allocation.
+ */
+struct MdbNode {
+    struct MdbRec rec;
+    struct Link link;
+};
+
+/*
+ * Returns the record whose MdbNode contains 'link'.
+ */
+static inline struct MdbRec *mdbRecOf(struct Link *link)
+{
+    return &containerOf(link, struct MdbNode, link)->rec;
+}
+
+int loadmdb(FILE *fp, struct IList *dest);
+void freemdb(struct IList *list);
+
+/*
+ * Read all records into a record-mode vector of struct MdbRec (see
+ * initRecVec()), so that the whole database is one flat allocation.
+ * Returns the number of records read, or -1 on error.  Free the
+ * records with freeVec().
+ */
+int loadmdbvec(FILE *fp, struct Vec *dest);
+
+/*
+ * A database file mapped into memory with mapmdb().
+ *
+ * 'recs' points straight at the file's pages, so the records are never
+ * copied: opening a database costs the same whatever its size, and
+ * processes that map the same file share its pages through the page
+ * cache.  'count' is the number of whole records in the file; a partial
+ * record at the end is ignored.  'size' is the length of the mapping.
+ */
+struct MdbMap {
+    const struct MdbRec *recs;
+    size_t count;
+    size_t size;
+};
+
+/*
+ * Map the database file 'filename' read-only.  An empty file gives an
+ * empty map whose 'recs' is NULL.
+ * Returns 0 on success, or -1 on error with errno set.  Unmap it with
+ * unmapmdb().
+ */
+int mapmdb(const char *filename, struct MdbMap *map);
+void unmapmdb(struct MdbMap *map);
+
+/*
+ * The database in columnar (structure-of-arrays) form: all names in one
+ * contiguous array and all msgs in another, with the length of each
+ * field precomputed.
+ *
+ * Scanning records laid out as struct MdbRec drags every byte of every
+ * record through the cache.  With the fields apart, each column is a
+ * dense run of same-width fields that the SIMD kernels in myscan.h
+ * stream through, and when a query only needs one field, the other is
+ * never read.
+ *
+ * Fields are copied as they are in the file, so one that fills its
+ * whole width has no null terminator; use the lengths.
+ */
+struct MdbColumns {
+    char (*names)[16];
+    char (*msgs)[24];
+    unsigned char *nameLens;
+    unsigned char *msgLens;
+    size_t count;
+};
+
+/*
+ * Load the records of the mapped database 'db' into 'cols'.
+ * Returns 0 on success and -1 on failure, leaving 'cols' empty.  Free
+ * the columns with freemdbcols().
+ */
+int loadmdbcols(const struct MdbMap *db, struct MdbColumns *cols);
+void freemdbcols(struct MdbColumns *cols);
+
+/*
+ * Append to 'matches', a record-mode vector of uint32_t, the numbers of
+ * the records 'from' through 'to' - 1 whose name or msg contains 'key',
+ * in increasing order.
+ *
+ * Returns the number of matches appended, or -1 if memory ran out.
+ */
+int scanmdbcols(const struct MdbColumns *cols, const char *key,
+    size_t from, size_t to, struct Vec *matches);
+
+/*
+ * Same as scanmdbcols(), but split the records into 'nthreads'
+ * contiguous slices and scan them on that many threads.  The matches
+ * come out in the same order as with scanmdbcols().
+ *
+ * Slices are at least MDB_SCAN_MIN_SLICE records long, so small ranges
+ * are scanned on fewer threads, or just the calling one.  If a thread
+ * can't be started, the calling thread scans its slice instead.
+ */
+int parallelscanmdbcols(const struct MdbColumns *cols, const char *key,
+    size_t from, size_t to, struct Vec *matches, int nthreads);
+
+#define MDB_SCAN_MIN_SLICE 16384
+
+/*
+ * Get a trigram index (see mytrigram.h) over the names and msgs of the
+ * mapped database 'db', whose file is 'filename'.
+ *
+ * The index may be kept in a sidecar file next to the database, named
+ * after it with ".tri" appended, and is mapped from there if it
+ * exists.  Since databases only ever grow at the end, an index built
+ * for fewer records is still good for those; matchmdb() scans the rest.
+ * The sidecar records a hash of the records it covers, so one left
+ * behind by a database that has since been replaced is not used.  The
+ * index is built in memory when the sidecar is missing, invalid or not
+ * this database's, or when the records it doesn't cover make up more
+ * than an eighth of those it does.  Only if 'save' is nonzero is the
+ * index so built written to the sidecar.
+ *
+ * Returns 0 on success.  On failure, returns -1 and leaves 'index'
+ * empty, which still works with matchmdb(), just without speeding it
+ * up.  Free the index with freeTrigramIndex().
+ */
+int indexmdb(const char *filename, const struct MdbMap *db,
+    struct TrigramIndex *index, int save);
+
+/*
+ * Find the records in 'cols' whose name or msg contains 'key', using
+ * 'index' to skip records that can't match when 'key' is long enough.
+ * The numbers of the matching records (counting from 0) are put in
+ * increasing order into 'matches', which must be a record-mode vector
+ * of uint32_t.
+ *
+ * Records that have to be scanned are scanned on up to 'nthreads'
+ * threads, as with parallelscanmdbcols().
+ *
+ * Returns the number of matches, or -1 if memory ran out.
+ */
+int matchmdb(const struct MdbColumns *cols, const struct TrigramIndex *index,
+    const char *key, struct Vec *matches, int nthreads);
+
+/*
+ * Put into matches[k] what matchmdb() would for keys[k], for each of
+ * the 'nkeys' keys; 'matches' is an array of 'nkeys' record-mode
+ * vectors of uint32_t.
+ *
+ * Keys the index can narrow down are looked up one by one, as are
+ * keys that are alone in needing a full scan.  All the others are
+ * matched against each record in a single pass with an Aho-Corasick
+ * automaton (see myaho.h), instead of one pass per key.  That pass
+ * runs on the calling thread; 'nthreads' is for the lookups made with
+ * matchmdb().
+ *
+ * Returns 0, or -1 if memory ran out.
+ */
+int matchmdbbatch(const struct MdbColumns *cols, const struct TrigramIndex *index,
+    const char *const *keys, int nkeys, struct Vec *matches, int nthreads);
 
 #endif /* _MDB_H_ */
@@ -0,0 +1,55 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mdb-cache.h"
+
+#define Entries 64
+#define Keys 2000
+
+int main(void)
+{
+    struct MdbCache cache;
+    char key[8], resp[16];
+    const char *found;
+    size_t len;
+    int resizing = 0;
+
+    initmdbcache(&cache, Entries, 1 << 20, 5);
+
+    // Once the cache is full, every add evicts the least recently used
+    // entry.  The tombstones that evictions leave in the hash table
+    // keep it resizing, so entries get evicted both from the table
+    // being drained and from the new one.  None may be found again.
+    printf("testing eviction while the hash table resizes: ");
+    for (int i = 0; i < Keys; i++) {
+        sprintf(key, "%d", i);
+        int n = sprintf(resp, "resp %d\n", i);
+        int result = addmdbcache(&cache, key, 1, resp, n);
+        assert(result == 0);
+        if (cache.map.old.entries != NULL)
+            resizing++;
+
+        found = findmdbcache(&cache, key, 1, &len);
+        assert(found && len == (size_t)n && memcmp(found, resp, len) == 0);
+
+        if (i >= Entries) {
+            sprintf(key, "%d", i - Entries);
+            found = findmdbcache(&cache, key, 1, &len);
+            assert(found == NULL);
+        }
+    }
+    assert(resizing > 0 && cache.count == Entries);
+
+    // The most recent keys are all still there, with their responses.
+    for (int i = Keys - Entries; i < Keys; i++) {
+        sprintf(key, "%d", i);
+        int n = sprintf(resp, "resp %d\n", i);
+        found = findmdbcache(&cache, key, 1, &len);
+        assert(found && len == (size_t)n && memcmp(found, resp, len) == 0);
+    }
+    printf("%zu entries\n", cache.count);
+
+    freemdbcache(&cache);
+    return 0;
+}
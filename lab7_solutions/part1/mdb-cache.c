@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "mdb-cache.h"
+
+void initmdbcache(struct MdbCache *cache, size_t max_entries, size_t max_bytes,
+    size_t key_max)
+{
+    memset(cache, 0, sizeof(*cache));
+    initHash(&cache->map, &hashString, &compareString);
+    cache->max_entries = max_entries;
+    cache->max_bytes = max_bytes;
+    cache->key_max = key_max;
+}
+
+static void unlink_entry(struct MdbCache *cache, struct MdbCacheEntry *e)
+{
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        cache->head = e->next;
+
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        cache->tail = e->prev;
+}
+
+static void push_front(struct MdbCache *cache, struct MdbCacheEntry *e)
+{
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head)
+        cache->head->prev = e;
+    else
+        cache->tail = e;
+    cache->head = e;
+}
+
+static void remove_entry(struct MdbCache *cache, struct MdbCacheEntry *e)
+{
+    removeHash(&cache->map, e->key);
+    unlink_entry(cache, e);
+    cache->count--;
+    cache->bytes -= e->len;
+    free(e->resp);
+    free(e);
+}
+
+void clearmdbcache(struct MdbCache *cache)
+{
+    struct MdbCacheEntry *e = cache->head;
+    while (e) {
+        struct MdbCacheEntry *next = e->next;
+        free(e->resp);
+        free(e);
+        e = next;
+    }
+
+    removeAllHash(&cache->map);
+    cache->head = cache->tail = NULL;
+    cache->count = 0;
+    cache->bytes = 0;
+}
+
+// Drop everything computed from another generation of the database.
+static void check_generation(struct MdbCache *cache, unsigned long generation)
+{
+    if (generation != cache->generation) {
+        clearmdbcache(cache);
+        cache->generation = generation;
+    }
+}
+
+const char *findmdbcache(struct MdbCache *cache, const char *key,
+    unsigned long generation, size_t *len)
+{
+    check_generation(cache, generation);
+
+    struct MdbCacheEntry *e = (struct MdbCacheEntry *)findHash(&cache->map, key);
+    if (e == NULL) {
+        cache->misses++;
+        return NULL;
+    }
+
+    cache->hits++;
+    unlink_entry(cache, e);
+    push_front(cache, e);
+
+    *len = e->len;
+    return e->resp;
+}
+
+int addmdbcache(struct MdbCache *cache, const char *key,
+    unsigned long generation, const char *resp, size_t len)
+{
+    check_generation(cache, generation);
+
+    // One response shouldn't be able to push out most of the others.
+    size_t key_len = strlen(key);
+    if (key_len > cache->key_max || len > cache->max_bytes / 4
+        || cache->max_entries == 0)
+        return 0;
+
+    struct MdbCacheEntry *e =
+        (struct MdbCacheEntry *)malloc(sizeof(*e) + key_len + 1);
+    char *copy = (char *)malloc(len ? len : 1);
+    if (e == NULL || copy == NULL) {
+        free(e);
+        free(copy);
+        return -1;
+    }
+
+    memcpy(e->key, key, key_len + 1);
+    memcpy(copy, resp, len);
+    e->resp = copy;
+    e->len = len;
+
+    // Replace any response already cached for the key.
+    struct MdbCacheEntry *old = (struct MdbCacheEntry *)findHash(&cache->map, key);
+    if (old)
+        remove_entry(cache, old);
+
+    if (insertHash(&cache->map, e->key, e) < 0) {
+        free(copy);
+        free(e);
+        return -1;
+    }
+    push_front(cache, e);
+    cache->count++;
+    cache->bytes += len;
+
+    while (cache->count > cache->max_entries || cache->bytes > cache->max_bytes)
+        remove_entry(cache, cache->tail);
+
+    return 0;
+}
+
+void freemdbcache(struct MdbCache *cache)
+{
+    clearmdbcache(cache);
+}
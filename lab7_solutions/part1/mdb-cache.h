@@ -0,0 +1,64 @@
+#ifndef __MDB_CACHE_H__
+#define __MDB_CACHE_H__
+
+#include <stddef.h>
+
+#include <myhash.h>
+
+// A cached response: the bytes sent back for a lookup of 'key'.
+// 'prev' and 'next' link the entries from most to least recently used.
+// The key is allocated along with the entry, with room for the
+// cache's longest key.
+struct MdbCacheEntry {
+    char *resp;
+    size_t len;
+    struct MdbCacheEntry *prev;
+    struct MdbCacheEntry *next;
+    char key[];
+};
+
+// A bounded LRU cache of lookup responses, found by key through 'map'.
+// It holds at most 'max_entries' entries and 'max_bytes' bytes of
+// responses, evicting the least recently used entries to make room.
+// Keys are at most 'key_max' bytes long.
+//
+// Every entry was computed from the database generation 'generation'.
+// Looking up any other generation empties the cache first, since the
+// records have changed.  'hits' and 'misses' count lookups.
+struct MdbCache {
+    struct HashMap map;
+    struct MdbCacheEntry *head;
+    struct MdbCacheEntry *tail;
+    size_t count;
+    size_t bytes;
+    size_t max_entries;
+    size_t max_bytes;
+    size_t key_max;
+    unsigned long generation;
+    unsigned long hits;
+    unsigned long misses;
+};
+
+void initmdbcache(struct MdbCache *cache, size_t max_entries, size_t max_bytes,
+    size_t key_max);
+
+// Returns the response cached for 'key' in database generation
+// 'generation' and sets '*len' to its length, or returns NULL.  The
+// response stays valid until the next call that changes the cache.
+const char *findmdbcache(struct MdbCache *cache, const char *key,
+    unsigned long generation, size_t *len);
+
+// Cache a copy of the 'len' bytes at 'resp' as the response for 'key'
+// in generation 'generation'.  Responses too big to share the cache
+// with others, and keys that are too long, aren't cached.  Returns -1
+// if memory ran out, in which case nothing is cached for 'key'.
+int addmdbcache(struct MdbCache *cache, const char *key,
+    unsigned long generation, const char *resp, size_t len);
+
+// Remove all entries.  The counters are kept.
+void clearmdbcache(struct MdbCache *cache);
+
+// Free all the memory the cache holds.
+void freemdbcache(struct MdbCache *cache);
+
+#endif
@@ -1,19 +1,26 @@
 #define _GNU_SOURCE
 #include <arpa/inet.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "mdb-cache.h"
 #include "mdb.h"
-#include <mylist.h>
 
 #define KeyMax 5
 
@@ -23,116 +30,779 @@ static void die(const char *s)
     exit(1);
 }
 
-static void handle_client(const char *mdb_filename, int clnt_fd)
+/*
+ * Turn a line of client input into a lookup key: its first KeyMax
+ * characters, without the newline or carriage return.  Only the first
+ * KeyMax characters of 'line' are looked at, so the rest of the line
+ * doesn't have to be kept around.
+ */
+static void clean_key(char *key, const char *line)
 {
-    /*
-     * Wrap client file descriptor in FILE pointers.
-     */
+    strncpy(key, line, KeyMax);
+    key[KeyMax] = '\0';
+
+    // If newline is within the first KeyMax characters, remove it.
+    int last = strlen(key) - 1;
+    if (last >= 0 && key[last] == '\n')
+        key[last] = '\0';
+
+    // Do the same with carriage return.
+    last = strlen(key) - 1;
+    if (last >= 0 && key[last] == '\r')
+        key[last] = '\0';
+}
+
+// Longest line that append_match() writes, including the null
+// terminator snprintf() wants room for.
+#define MatchLineMax 80
+
+static int append_match(struct Vec *out, uint32_t recNo, const struct MdbRec *rec)
+{
+    char line[MatchLineMax];
+
+    // A record from a damaged file may not be null-terminated.
+    int n = snprintf(line, sizeof(line), "%4d: {%.*s} said {%.*s}\n",
+        (int)recNo + 1, (int)sizeof(rec->name), rec->name,
+        (int)sizeof(rec->msg), rec->msg);
 
-    FILE *clnt_r = fdopen(clnt_fd, "rb"),
-         *clnt_w = fdopen(dup(clnt_fd), "wb");
+    return appendRecsVec(out, line, (size_t)n);
+}
+
+/*
+ * Responses to recent lookups, for clients that keep asking for the
+ * same keys.  Every process has its own.  SIGUSR1 makes a process
+ * print its hit and miss counts to stderr.
+ */
+#define CacheEntries 256
+#define CacheBytes (16 << 20)
+
+static struct MdbCache cache;
+static volatile sig_atomic_t stats_wanted;
+
+static void sigusr1_handler(int sig)
+{
+    stats_wanted = 1;
+}
 
-    if (clnt_r == NULL || clnt_w == NULL) {
-        perror("fdopen");
-        goto clnt_out;
+static void print_stats(void)
+{
+    if (!stats_wanted)
+        return;
+    stats_wanted = 0;
+
+    fprintf(stderr, "[%d] cache: %lu hits, %lu misses, %zu entries, %zu bytes\n",
+        (int)getpid(), cache.hits, cache.misses, cache.count, cache.bytes);
+}
+
+/*
+ * Split client input into lines.  Only the first KeyMax characters of
+ * a line matter to clean_key(), so that's all 'line' keeps of the line
+ * being read; the rest of it is skipped up to the newline.
+ */
+struct LineReader {
+    char line[KeyMax + 1];
+    size_t len;
+};
+
+// Most keys looked up in one batch.
+#define BatchKeys 64
+
+// Stop answering a client while this many response bytes are waiting
+// to be sent to it.
+#define OutMax (1 << 20)
+
+/*
+ * Append to 'keys', a record-mode vector of char[KeyMax + 1], the key
+ * of every line that the 'n' bytes at 'buf' complete, stopping once
+ * 'keys' holds 'max_keys' keys.  'n' is 0 once the client has hung up;
+ * like fgets(), we still count a last line that has no newline.
+ *
+ * ends[i] is set to the number of bytes up to the end of the line that
+ * gave keys[i], for each key appended.
+ * Returns the number of bytes used, which is short of 'n' only if we
+ * stopped early, or -1 if memory ran out.
+ */
+static ssize_t read_keys(struct LineReader *r, const char *buf, size_t n,
+    struct Vec *keys, size_t max_keys, size_t *ends)
+{
+    char key[KeyMax + 1];
+
+    if (n == 0 && r->len > 0) {
+        r->line[r->len] = '\0';
+        r->len = 0;
+        clean_key(key, r->line);
+        ends[vecLength(keys)] = 0;
+        return pushRecVec(keys, key) ? 0 : -1;
     }
 
-    FILE *mdb_fp = fopen(mdb_filename, "rb");
-    if (mdb_fp == NULL) {
-        perror("fopen");
-        goto clnt_out;
+    const char *p = buf, *end = buf + n;
+    while (p < end && vecLength(keys) < max_keys) {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        size_t seg = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+
+        // Keep the newline if it falls within the first KeyMax
+        // characters, as fgets() would have.
+        size_t keep = KeyMax - r->len < seg ? KeyMax - r->len : seg;
+        memcpy(r->line + r->len, p, keep);
+        r->len += keep;
+
+        if (nl) {
+            r->line[r->len] = '\0';
+            r->len = 0;
+            clean_key(key, r->line);
+            ends[vecLength(keys)] = (size_t)(nl + 1 - buf);
+            if (pushRecVec(keys, key) == NULL)
+                return -1;
+        }
+        p += seg;
     }
+    return p - buf;
+}
 
-    /*
-     * Read all records into memory.
-     */
+/*
+ * How one key of a batch gets answered: from the cache ('resp' and
+ * 'len'), or from matches[match] after a lookup.  'start' is where its
+ * response begins in the output.
+ */
+struct KeyLookup {
+    const char *key;
+    const char *resp;
+    size_t len;
+    int match;
+    size_t start;
+};
+
+/*
+ * Append the responses to lookups of the keys in 'keys', in order, to
+ * 'out'.  Each is a line for each matching record, then a blank line.
+ * Once 'out' holds 'limit' bytes, no more responses are added, so the
+ * last one may take it past 'limit', but only by that one response.
+ *
+ * Keys that aren't cached are looked up together with matchmdbbatch(),
+ * so a client that sends many keys at once has the database scanned
+ * once for all of them rather than once for each.  Returns the number
+ * of keys answered, which is at least one if there were any, or -1 if
+ * memory ran out.
+ */
+static int lookup_keys(struct MdbLive *db, const struct Vec *keys,
+    struct Vec *out, size_t limit)
+{
+    size_t nkeys = vecLength(keys);
+    if (nkeys == 0)
+        return 0;
+
+    // Pick up any records added since the last lookup.  If the
+    // database can't be read right now, use the records we have.
+    refreshmdblive(db);
+    print_stats();
+
+    struct KeyLookup *lk = (struct KeyLookup *)malloc(nkeys * sizeof(*lk));
+    const char **miss_keys = (const char **)malloc(nkeys * sizeof(char *));
+    struct Vec *matches = (struct Vec *)malloc(nkeys * sizeof(struct Vec));
+    int nmiss = 0, result = -1;
+    size_t answered = 0;
+
+    if (lk == NULL || miss_keys == NULL || matches == NULL)
+        goto out;
+
+    // The cache is emptied whenever the records change.  The responses
+    // we find in it stay put until we add to it, which we do only once
+    // they have all been copied out.
+    for (size_t k = 0; k < nkeys; k++) {
+        lk[k].key = (const char *)vecAt(keys, k);
+        lk[k].resp = findmdbcache(&cache, lk[k].key, db->generation, &lk[k].len);
+        lk[k].match = -1;
+        if (lk[k].resp == NULL) {
+            lk[k].match = nmiss;
+            initRecVec(&matches[nmiss], sizeof(uint32_t));
+            miss_keys[nmiss++] = lk[k].key;
+        }
+    }
+
+    if (matchmdbbatch(&db->map, &db->index, miss_keys, nmiss, matches) < 0)
+        goto out;
 
-    struct List list;
-    initList(&list);
+    for (size_t k = 0; k < nkeys && (k == 0 || vecLength(out) < limit); k++) {
+        lk[k].start = vecLength(out);
+        answered = k + 1;
 
-    struct MdbRec r;
-    struct Node *node = NULL;
+        if (lk[k].resp) {
+            if (appendRecsVec(out, lk[k].resp, lk[k].len) < 0)
+                goto out;
+            continue;
+        }
 
-    while (fread(&r, sizeof(r), 1, mdb_fp) == 1) {
-        struct MdbRec *rec = (struct MdbRec *)malloc(sizeof(r));
-        if (!rec)
-            die("malloc");
+        struct Vec *m = &matches[lk[k].match];
+        for (size_t i = 0; i < vecLength(m); i++) {
+            uint32_t recNo = *(uint32_t *)vecAt(m, i);
 
-        memcpy(rec, &r, sizeof(r));
+            if (append_match(out, recNo, &db->map.recs[recNo]) < 0)
+                goto out;
+        }
 
-        node = addAfter(&list, node, rec);
-        if (node == NULL)
-            die("addAfter");
+        if (appendRecsVec(out, "\n", 1) < 0)
+            goto out;
     }
 
-    fclose(mdb_fp);
+    // Not being able to cache a response doesn't matter.
+    for (size_t k = 0; k < answered; k++) {
+        if (lk[k].resp == NULL) {
+            size_t end = k + 1 < answered ? lk[k + 1].start : vecLength(out);
+            addmdbcache(&cache, lk[k].key, db->generation,
+                (const char *)vecAt(out, lk[k].start), end - lk[k].start);
+        }
+    }
+    result = (int)answered;
+
+out:
+    for (int m = 0; m < nmiss; m++)
+        freeVec(&matches[m]);
+    free(lk);
+    free(miss_keys);
+    free(matches);
+    return result;
+}
 
-    char line[1024];
-    char key[KeyMax + 1];
+/*
+ * Look up the keys of up to BatchKeys lines from the 'n' bytes at
+ * 'buf', and append their responses to 'out' until it holds 'limit'
+ * bytes; 'n' is 0 once the client has hung up.  Returns the number of
+ * bytes used, short of the last lines read if their responses didn't
+ * fit, or -1 if memory ran out.  Unless 'n' is 0, some bytes are
+ * always used.
+ */
+static ssize_t answer_batch(struct MdbLive *db, struct LineReader *r,
+    const char *buf, size_t n, struct Vec *keys, struct Vec *out,
+    size_t limit)
+{
+    size_t ends[BatchKeys];
+
+    clearVec(keys);
+    ssize_t used = read_keys(r, buf, n, keys, BatchKeys, ends);
+    if (used < 0)
+        return -1;
+
+    int answered = lookup_keys(db, keys, out, limit);
+    if (answered < 0)
+        return -1;
+
+    // The lines whose responses didn't fit are read again next time,
+    // starting right after the last line answered.
+    if ((size_t)answered < vecLength(keys)) {
+        r->len = 0;
+        return (ssize_t)ends[answered - 1];
+    }
+    return used;
+}
+
+// Write all 'n' bytes at 'p' to the blocking socket 'fd'.
+static int send_all(int fd, const char *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t sent = write(fd, p, n);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += sent;
+        n -= (size_t)sent;
+    }
+    return 0;
+}
 
-    while (fgets(line, sizeof(line), clnt_r) != NULL) {
+static void handle_client(struct MdbLive *db, int clnt_fd)
+{
+    struct LineReader reader = { .len = 0 };
+    struct Vec keys, out;
+    initRecVec(&keys, KeyMax + 1);
+    initRecVec(&out, 1);
+
+    char buf[4096];
+
+    for (;;) {
+        ssize_t n = read(clnt_fd, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("recv");
+            break;
+        }
 
         /*
-         * Clean up user input.
+         * Answer the lines that came in a batch at a time.  An
+         * interactive client sends one line at a time, but one that
+         * pipelines its keys gets them looked up together.  Each
+         * batch's responses are sent before the next batch is looked
+         * up, so the client can't get further ahead of reading them
+         * than the socket lets it.
          */
 
-        strncpy(key, line, sizeof(key) - 1);
-        key[sizeof(key) - 1] = '\0';
+        size_t used = 0;
+        do {
+            clearVec(&out);
+            ssize_t k = answer_batch(db, &reader, buf + used, (size_t)n - used,
+                &keys, &out, OutMax);
+            if (k < 0) {
+                perror("lookup");
+                goto done;
+            }
+            used += (size_t)k;
+
+            if (vecLength(&out) > 0
+                && send_all(clnt_fd, (const char *)vecAt(&out, 0), vecLength(&out)) < 0) {
+                perror("send");
+                goto done;
+            }
+        } while (used < (size_t)n);
 
-        // If newline is within the first KeyMax characters, remove it.
-        int last = strlen(key) - 1;
-        if (key[last] == '\n')
-            key[last] = '\0';
+        if (n == 0)
+            break;
+    }
 
-        // Do the same with carriage return.
-        last = strlen(key) - 1;
-        if (last >= 0 && key[last] == '\r')
-            key[last] = '\0';
+done:
+    if (close(clnt_fd) < 0)
+        perror("close");
+    freeVec(&keys);
+    freeVec(&out);
+}
 
-        // Make sure we've encountered a newline with fgets().
-        while (line[strlen(line) - 1] != '\n' && fgets(line, sizeof(line), clnt_r))
-            ;
+// Serve one client on this process, logging the connection.
+static void serve_client(struct MdbLive *db, int clnt_fd,
+    const struct sockaddr_in *clnt_addr)
+{
+    char clnt_ip[INET_ADDRSTRLEN];
 
-        /*
-         * Perform search with key.
-         */
+    if (inet_ntop(AF_INET, &clnt_addr->sin_addr, clnt_ip, sizeof(clnt_ip))
+        == NULL)
+        die("inet_ntop");
 
-        int recNo = 1;
+    fprintf(stderr, "Connection started: %s\n", clnt_ip);
 
-        for (struct Node *node = list.head; node; node = node->next, recNo++) {
-            struct MdbRec *rec = (struct MdbRec *)node->data;
+    handle_client(db, clnt_fd);
 
-            if (strstr(rec->name, key) || strstr(rec->msg, key)) {
-                if (fprintf(clnt_w, "%4d: {%s} said {%s}\n", recNo, rec->name, rec->msg) < 0) {
-                    perror("send");
-                    goto clnt_out;
-                }
-            }
+    fprintf(stderr, "Connection terminated: %s\n", clnt_ip);
+}
+
+/*
+ * Event-driven mode: one process serves every client from a single
+ * epoll loop, with non-blocking sockets.
+ */
+
+#define MaxEvents 64
+
+/*
+ * A client of the event-driven server.  Responses queue up in 'out'
+ * until the socket takes them, 'out_sent' bytes of which have been
+ * sent.  Input that came in while OutMax bytes were queued waits in
+ * 'in', from 'in_used' on, until the client has read enough of them.
+ * 'events' is what we are currently waiting for on the socket.
+ */
+struct Client {
+    int fd;
+    char ip[INET_ADDRSTRLEN];
+    struct LineReader reader;
+    struct Vec in;
+    size_t in_used;
+    struct Vec out;
+    size_t out_sent;
+    int eof;
+    uint32_t events;
+};
+
+static size_t pending_output(const struct Client *c)
+{
+    return vecLength(&c->out) - c->out_sent;
+}
+
+static int held_input(const struct Client *c)
+{
+    return c->in_used < vecLength(&c->in);
+}
+
+static void close_client(int ep_fd, struct Client *c)
+{
+    epoll_ctl(ep_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    fprintf(stderr, "Connection terminated: %s\n", c->ip);
+    freeVec(&c->in);
+    freeVec(&c->out);
+    free(c);
+}
+
+static void accept_clients(int ep_fd, int serv_fd)
+{
+    for (;;) {
+        struct sockaddr_in clnt_addr;
+        socklen_t clnt_len = sizeof(clnt_addr);
+
+        int clnt_fd = accept4(serv_fd, (struct sockaddr *)&clnt_addr,
+            &clnt_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clnt_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            // EAGAIN means we've taken every pending connection.  If
+            // we're out of descriptors or memory, the rest wait in the
+            // backlog until some clients go away.
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept");
+            return;
+        }
+
+        struct Client *c = (struct Client *)malloc(sizeof(struct Client));
+        if (c == NULL) {
+            perror("malloc");
+            close(clnt_fd);
+            continue;
+        }
+
+        c->fd = clnt_fd;
+        c->reader.len = 0;
+        initRecVec(&c->in, 1);
+        c->in_used = 0;
+        initRecVec(&c->out, 1);
+        c->out_sent = 0;
+        c->eof = 0;
+        c->events = EPOLLIN;
+
+        if (inet_ntop(AF_INET, &clnt_addr.sin_addr, c->ip, sizeof(c->ip)) == NULL)
+            strcpy(c->ip, "?");
+
+        struct epoll_event ev = { .events = c->events, .data.ptr = c };
+        if (epoll_ctl(ep_fd, EPOLL_CTL_ADD, clnt_fd, &ev) < 0) {
+            perror("epoll_ctl");
+            close(clnt_fd);
+            free(c);
+            continue;
+        }
+
+        fprintf(stderr, "Connection started: %s\n", c->ip);
+    }
+}
+
+// Answer the complete lines in the 'n' bytes at 'buf', a batch at a
+// time, until they run out or OutMax bytes of responses are queued.
+// Returns the number of bytes used, or -1 if memory ran out.
+static ssize_t answer_lines(struct MdbLive *db, struct Client *c,
+    const char *buf, size_t n, struct Vec *keys)
+{
+    size_t used = 0;
+
+    while (used < n && pending_output(c) < OutMax) {
+        ssize_t k = answer_batch(db, &c->reader, buf + used, n - used, keys,
+            &c->out, c->out_sent + OutMax);
+        if (k < 0)
+            return -1;
+        used += (size_t)k;
+    }
+    return (ssize_t)used;
+}
+
+// Answer more of the input held back in 'c->in'.  Returns -1 if the
+// client should be dropped.
+static int resume_client(struct MdbLive *db, struct Client *c, struct Vec *keys)
+{
+    ssize_t used = answer_lines(db, c, (const char *)vecAt(&c->in, c->in_used),
+        vecLength(&c->in) - c->in_used, keys);
+    if (used < 0)
+        return -1;
+
+    c->in_used += (size_t)used;
+    if (!held_input(c)) {
+        freeVec(&c->in);
+        c->in_used = 0;
+    }
+    return 0;
+}
+
+// Read what the client sent and answer the complete lines in it,
+// holding back what doesn't fit under OutMax.  Returns -1 if the
+// client should be dropped.
+static int read_client(struct MdbLive *db, struct Client *c, struct Vec *keys)
+{
+    // Don't take more input until what we have is answered.
+    if (held_input(c))
+        return 0;
+
+    char buf[16384];
+    ssize_t n = read(c->fd, buf, sizeof(buf));
+
+    if (n < 0)
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+
+    if (n == 0) {
+        c->eof = 1;
+        return answer_batch(db, &c->reader, buf, 0, keys, &c->out, SIZE_MAX) < 0
+            ? -1 : 0;
+    }
+
+    ssize_t used = answer_lines(db, c, buf, (size_t)n, keys);
+    if (used < 0)
+        return -1;
+    return appendRecsVec(&c->in, buf + used, (size_t)(n - used));
+}
+
+// Send as much of the queued output as the socket takes.  Returns -1
+// if the client should be dropped.
+static int write_client(struct Client *c)
+{
+    while (c->out_sent < vecLength(&c->out)) {
+        ssize_t n = write(c->fd, (const char *)vecAt(&c->out, c->out_sent),
+            vecLength(&c->out) - c->out_sent);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            return -1;
         }
+        c->out_sent += (size_t)n;
+    }
 
-        fputs("\n", clnt_w);
+    // Everything is sent.  Don't hang on to the memory of a big
+    // response.
+    if (vecLength(&c->out) > OutMax)
+        freeVec(&c->out);
+    clearVec(&c->out);
+    c->out_sent = 0;
+    return 0;
+}
 
-        if (fflush(clnt_w) < 0) {
-            perror("send");
-            goto clnt_out;
+// Wait for input while the client keeps up with our output, and for
+// the socket to drain while output is queued.  Returns 1 if the client
+// is done: it has hung up and has been sent everything.
+static int update_events(int ep_fd, struct Client *c)
+{
+    size_t pending = pending_output(c);
+
+    if (c->eof && pending == 0)
+        return 1;
+
+    uint32_t events = (!c->eof && !held_input(c) && pending < OutMax ? EPOLLIN : 0)
+        | (pending > 0 ? EPOLLOUT : 0);
+
+    if (events != c->events) {
+        struct epoll_event ev = { .events = events, .data.ptr = c };
+        if (epoll_ctl(ep_fd, EPOLL_CTL_MOD, c->fd, &ev) < 0) {
+            perror("epoll_ctl");
+            return 1;
         }
+        c->events = events;
     }
+    return 0;
+}
 
-    traverseList(&list, &free);
-    removeAllNodes(&list);
+static void serve_events(int serv_fd, struct MdbLive *db)
+{
+    // Every client costs a descriptor, so allow as many as we may.
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    int flags = fcntl(serv_fd, F_GETFL);
+    if (flags < 0 || fcntl(serv_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        die("fcntl");
+
+    int ep_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (ep_fd < 0)
+        die("epoll_create1");
+
+    // The listening socket is the one without a client.  Workers all
+    // wait on it, so only wake one of them per connection.
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL };
+    if (epoll_ctl(ep_fd, EPOLL_CTL_ADD, serv_fd, &ev) < 0)
+        die("epoll_ctl");
+
+    struct Vec keys;
+    initRecVec(&keys, KeyMax + 1);
+
+    struct epoll_event events[MaxEvents];
 
-clnt_out:
-    if (clnt_w && fclose(clnt_w) < 0)
-        perror("send");
-    if (clnt_r && fclose(clnt_r) < 0)
-        perror("recv");
+    for (;;) {
+        int n = epoll_wait(ep_fd, events, MaxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                print_stats();
+                continue;
+            }
+            die("epoll_wait");
+        }
+
+        for (int i = 0; i < n; i++) {
+            struct Client *c = (struct Client *)events[i].data.ptr;
+
+            if (c == NULL) {
+                accept_clients(ep_fd, serv_fd);
+                continue;
+            }
+
+            int drop = 0;
+
+            if (events[i].events & EPOLLERR)
+                drop = 1;
+            if (!drop && (events[i].events & (EPOLLIN | EPOLLHUP)) && !c->eof)
+                drop = read_client(db, c, &keys) < 0;
+            if (!drop)
+                drop = write_client(c) < 0;
+
+            // Input held back for the client to catch up is answered
+            // as soon as it has, whether or not it sends any more.
+            while (!drop && held_input(c) && pending_output(c) < OutMax)
+                drop = resume_client(db, c, &keys) < 0 || write_client(c) < 0;
+
+            if (drop || update_events(ep_fd, c))
+                close_client(ep_fd, c);
+        }
+    }
 }
 
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--epoll] [--workers N] <server-port> <database>\n",
+        prog);
+    exit(1);
+}
+
+/*
+ * Prefork mode: the parent forks a fixed set of long-lived workers,
+ * which all accept() on the listening socket, and replaces any worker
+ * that dies.
+ *
+ * 'workers' holds the worker pids, with 0 for a worker that has died
+ * and not been replaced yet.  Only the parent writes it, with SIGCHLD
+ * blocked, except for sigchld_handler() clearing the pids it reaps.
+ * 'worker_died' tells the parent to look for workers to replace.
+ */
+static pid_t *workers;
+static int nworkers;
+static volatile sig_atomic_t worker_died;
+
 static void sigchld_handler(int sig)
 {
+    int saved_errno = errno;
+    pid_t pid;
+
     // Keep reaping dead children until there aren't any to reap.
-    while (waitpid(-1, NULL, WNOHANG) > 0)
-        ;
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+        for (int i = 0; i < nworkers; i++) {
+            if (workers[i] == pid) {
+                workers[i] = 0;
+                worker_died = 1;
+            }
+        }
+    }
+
+    errno = saved_errno;
+}
+
+static void run_worker(int serv_fd, struct MdbLive *db, int event_mode,
+    pid_t parent)
+{
+    // Don't outlive the parent, which would leave nobody to restart
+    // us and keep the port taken.
+    if (prctl(PR_SET_PDEATHSIG, SIGTERM) < 0 || getppid() != parent)
+        exit(1);
+
+    // Workers live long; watch for records added in the meantime.
+    watchmdblive(db);
+
+    if (event_mode)
+        serve_events(serv_fd, db);
+
+    for (;;) {
+        struct sockaddr_in clnt_addr;
+        socklen_t clnt_len = sizeof(clnt_addr);
+
+        int clnt_fd = accept(serv_fd, (struct sockaddr *)&clnt_addr, &clnt_len);
+        if (clnt_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            die("accept");
+        }
+
+        serve_client(db, clnt_fd, &clnt_addr);
+    }
+}
+
+static pid_t start_worker(int serv_fd, struct MdbLive *db, int event_mode)
+{
+    pid_t parent = getpid();
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        // The parent blocked SIGCHLD around fork(); workers don't need
+        // it blocked.
+        sigset_t set;
+        sigemptyset(&set);
+        sigprocmask(SIG_SETMASK, &set, NULL);
+
+        run_worker(serv_fd, db, event_mode, parent);
+    }
+    return pid;
+}
+
+static void sigalrm_handler(int sig)
+{
+    // Restarting was put off; make the supervisor look again.
+    worker_died = 1;
+}
+
+static void supervise_workers(int serv_fd, struct MdbLive *db, int event_mode)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = &sigalrm_handler;
+    if (sigaction(SIGALRM, &sa, NULL))
+        die("sigaction(SIGALRM)");
+
+    // Block SIGCHLD except while waiting for it, so that the handler
+    // never sees 'workers' half-updated.
+    sigset_t chld, orig;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, &orig);
+
+    workers = (pid_t *)calloc(nworkers, sizeof(pid_t));
+    if (workers == NULL)
+        die("calloc");
+
+    worker_died = 1;
+    time_t last_round = 0;
+
+    for (;;) {
+        while (!worker_died)
+            sigsuspend(&orig);
+        worker_died = 0;
+
+        // Workers that keep dying right away would have us fork as
+        // fast as we can; restart at most once a second.
+        if (time(NULL) == last_round) {
+            alarm(1);
+            continue;
+        }
+        last_round = time(NULL);
+
+        // Start replacements with whatever records were added since
+        // the last workers started.
+        refreshmdblive(db);
+
+        for (int i = 0; i < nworkers; i++) {
+            if (workers[i] != 0)
+                continue;
+
+            pid_t pid = start_worker(serv_fd, db, event_mode);
+            if (pid < 0) {
+                // Try again in a bit; the other workers carry on.
+                perror("fork");
+                alarm(1);
+                continue;
+            }
+            workers[i] = pid;
+        }
+    }
 }
 
 int main(int argc, char **argv)
@@ -160,15 +830,39 @@ int main(int argc, char **argv)
     if (sigaction(SIGCHLD, &sa, NULL))
         die("sigaction(SIGCHLD)");
 
+    // SIGUSR1 asks for cache statistics.
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = &sigusr1_handler;
+    if (sigaction(SIGUSR1, &sa, NULL))
+        die("sigaction(SIGUSR1)");
+
+    initmdbcache(&cache, CacheEntries, CacheBytes, KeyMax);
+
     /*
      * Parse arguments.
      */
 
-    if (argc != 3) {
-        fprintf(stderr, "usage: %s <server-port> <database>\n", argv[0]);
-        exit(1);
+    const char *prog = argv[0];
+    int event_mode = 0;
+
+    for (; argc > 1 && argv[1][0] == '-'; argc--, argv++) {
+        if (strcmp(argv[1], "--epoll") == 0) {
+            event_mode = 1;
+        } else if (strcmp(argv[1], "--workers") == 0 && argc > 2) {
+            nworkers = atoi(argv[2]);
+            if (nworkers < 1)
+                usage(prog);
+            argc--;
+            argv++;
+        } else {
+            usage(prog);
+        }
     }
 
+    if (argc != 3)
+        usage(prog);
+
     const char *port = argv[1];
     const char *filename = argv[2];
 
@@ -197,11 +891,28 @@ int main(int argc, char **argv)
     if (bind(serv_fd, info->ai_addr, info->ai_addrlen) < 0)
         die("bind");
 
-    if (listen(serv_fd, 8) < 0)
+    // A single process serving everyone takes connections in bursts.
+    if (listen(serv_fd, event_mode ? SOMAXCONN : 8) < 0)
         die("listen");
 
     freeaddrinfo(info);
 
+    /*
+     * Map the database once, up front.  Children inherit the mapping
+     * and the index across fork(), so a connection doesn't have to
+     * map, index or read anything before it can answer.
+     */
+
+    struct MdbLive db;
+    if (openmdblive(filename, &db) < 0)
+        die(filename);
+
+    if (nworkers > 0)
+        supervise_workers(serv_fd, &db, event_mode);
+
+    if (event_mode)
+        serve_events(serv_fd, &db);
+
     /*
      * Server accept() loop.
      */
@@ -216,6 +927,10 @@ int main(int argc, char **argv)
         if (clnt_fd < 0)
             die("accept");
 
+        // Pick up any records added since the last connection, so that
+        // the child starts out with them.
+        refreshmdblive(&db);
+
         pid_t pid = fork();
         if (pid < 0)
             die("fork");
@@ -240,18 +955,13 @@ int main(int argc, char **argv)
 
         close(serv_fd);
 
-        char clnt_ip[INET_ADDRSTRLEN];
-
-        if (inet_ntop(AF_INET, &clnt_addr.sin_addr, clnt_ip, sizeof(clnt_ip))
-            == NULL)
-            die("inet_ntop");
-
-        fprintf(stderr, "Connection started: %s\n", clnt_ip);
-
-        handle_client(filename, clnt_fd);
+        // The connection may stay open for a while; watch for records
+        // added in the meantime.
+        watchmdblive(&db);
 
-        fprintf(stderr, "Connection terminated: %s\n", clnt_ip);
+        serve_client(&db, clnt_fd, &clnt_addr);
 
+        freemdbcache(&cache);
         exit(0);
     }
 }
@@ -0,0 +1,491 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <myaho.h>
+#include <myscan.h>
+
+#include "mdb.h"
+
+// Seconds to wait before starting another index builder.
+#define MDB_REBUILD_INTERVAL 10
+
+// Map the open database file 'fd', which fstat() says is 'st', and
+// close it.
+static int mapFd(int fd, const struct stat *st, struct MdbMap *map)
+{
+    // A partial record at the end of the file is ignored.
+    map->recs = NULL;
+    map->count = (size_t)st->st_size / sizeof(struct MdbRec);
+    map->size = map->count * sizeof(struct MdbRec);
+
+    // mmap() refuses zero-length mappings.
+    if (map->size > 0) {
+        void *p = mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        map->recs = (const struct MdbRec *)p;
+    }
+
+    // The mapping stays valid after the file is closed.
+    close(fd);
+    return 0;
+}
+
+int mapmdb(const char *filename, struct MdbMap *map)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return mapFd(fd, &st, map);
+}
+
+void unmapmdb(struct MdbMap *map)
+{
+    if (map->recs)
+        munmap((void *)map->recs, map->size);
+    map->recs = NULL;
+    map->count = 0;
+    map->size = 0;
+}
+
+// The sidecar is named after the database file.  Returns NULL if
+// memory ran out.
+static char *sidecarName(const char *filename)
+{
+    size_t len = strlen(filename);
+    char *sidecar = (char *)malloc(len + sizeof(".tri"));
+    if (sidecar == NULL)
+        return NULL;
+    memcpy(sidecar, filename, len);
+    memcpy(sidecar + len, ".tri", sizeof(".tri"));
+    return sidecar;
+}
+
+int indexmdb(const char *filename, const struct MdbMap *db,
+    struct TrigramIndex *index)
+{
+    initTrigramIndex(index);
+
+    char *sidecar = sidecarName(filename);
+    if (sidecar == NULL)
+        return -1;
+
+    // The database only grows at the end, so an index over its first
+    // records stays good for them, as long as it was built from this
+    // database and not one that has since been replaced.  Use it
+    // unless the records added since outnumber an eighth of those it
+    // covers.
+    if (loadTrigramIndex(index, sidecar) == 0
+        && checkTrigramIndex(index, db->recs, db->count, sizeof(struct MdbRec))
+        && db->count - index->count <= index->count / 8) {
+        free(sidecar);
+        return 0;
+    }
+
+    struct TextField fields[] = {
+        { offsetof(struct MdbRec, name), sizeof(db->recs->name) },
+        { offsetof(struct MdbRec, msg), sizeof(db->recs->msg) },
+    };
+
+    if (buildTrigramIndex(index, db->recs, db->count, sizeof(struct MdbRec),
+            fields, 2) < 0) {
+        free(sidecar);
+        return -1;
+    }
+
+    // If we can't save it, the next server to start builds it again.
+    saveTrigramIndex(index, sidecar);
+
+    free(sidecar);
+    return 0;
+}
+
+// A field may fill its whole width with no null byte, so the search
+// has to stop at the end of the field, as scanFields() does.
+static int recMatches(const struct MdbRec *rec, const char *key, size_t klen)
+{
+    return fieldContains(rec->name, sizeof(rec->name), key, klen)
+        || fieldContains(rec->msg, sizeof(rec->msg), key, klen);
+}
+
+int matchmdb(const struct MdbMap *db, const struct TrigramIndex *index,
+    const char *key, struct Vec *matches)
+{
+    // Records past the end of the index have to be scanned.
+    size_t covered = index->count < db->count ? index->count : db->count;
+    size_t scanFrom = 0;
+    size_t klen = strlen(key);
+
+    clearVec(matches);
+
+    if (findTrigramCandidates(index, key, matches) >= 0) {
+        // Keep the candidates that really contain the key.
+        uint32_t *ids = vecLength(matches) ? (uint32_t *)vecAt(matches, 0) : NULL;
+        size_t kept = 0;
+
+        for (size_t i = 0; i < vecLength(matches); i++) {
+            if (ids[i] < covered && recMatches(&db->recs[ids[i]], key, klen))
+                ids[kept++] = ids[i];
+        }
+        truncateVec(matches, kept);
+        scanFrom = covered;
+    } else {
+        // The key is too short for the index, or we ran out of memory.
+        clearVec(matches);
+    }
+
+    if (scanFrom >= db->count)
+        return (int)vecLength(matches);
+
+    // Scan the rest with the SIMD kernel, straight off the mapped
+    // records; a record's fields are 'sizeof(struct MdbRec)' apart.
+    size_t n = db->count - scanFrom;
+    const struct MdbRec *recs = db->recs + scanFrom;
+    unsigned char *hits = (unsigned char *)calloc(n, 1);
+    if (hits == NULL)
+        return -1;
+
+    scanFields(recs->name, sizeof(struct MdbRec), sizeof(recs->name),
+        n, key, hits);
+    scanFields(recs->msg, sizeof(struct MdbRec), sizeof(recs->msg),
+        n, key, hits);
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t id = (uint32_t)(scanFrom + i);
+        if (hits[i] && pushRecVec(matches, &id) == NULL) {
+            free(hits);
+            return -1;
+        }
+    }
+
+    free(hits);
+    return (int)vecLength(matches);
+}
+
+int matchmdbbatch(const struct MdbMap *db, const struct TrigramIndex *index,
+    const char *const *keys, int nkeys, struct Vec *matches)
+{
+    size_t n = nkeys ? (size_t)nkeys : 1;
+    const char **scanKeys = (const char **)malloc(n * sizeof(char *));
+    struct Vec **scanMatches = (struct Vec **)malloc(n * sizeof(struct Vec *));
+    int nscan = 0, result = -1;
+
+    if (scanKeys == NULL || scanMatches == NULL)
+        goto out;
+
+    // Keys the index narrows down are cheaper to look up on their own.
+    for (int k = 0; k < nkeys; k++) {
+        clearVec(&matches[k]);
+        if (index->count > 0 && strlen(keys[k]) >= 3) {
+            if (matchmdb(db, index, keys[k], &matches[k]) < 0)
+                goto out;
+        } else {
+            scanKeys[nscan] = keys[k];
+            scanMatches[nscan++] = &matches[k];
+        }
+    }
+
+    // Nothing to look for, or nothing to look in.
+    if (nscan == 0 || db->count == 0) {
+        result = 0;
+        goto out;
+    }
+
+    // For a single key, the SIMD scan in matchmdb() beats the automaton.
+    if (nscan == 1) {
+        result = matchmdb(db, index, scanKeys[0], scanMatches[0]) < 0 ? -1 : 0;
+        goto out;
+    }
+
+    // The rest are all matched in one pass over the records.
+    struct TextColumn columns[] = {
+        { db->recs->name, sizeof(struct MdbRec), sizeof(db->recs->name) },
+        { db->recs->msg, sizeof(struct MdbRec), sizeof(db->recs->msg) },
+    };
+    result = matchAhoCorasickColumns(scanKeys, nscan, columns, 2, db->count,
+        scanMatches);
+
+out:
+    free(scanKeys);
+    free(scanMatches);
+    return result;
+}
+
+int openmdblive(const char *filename, struct MdbLive *db)
+{
+    memset(db, 0, sizeof(*db));
+    db->filename = filename;
+    db->watch_fd = -1;
+    initTrigramIndex(&db->index);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &db->st) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (mapFd(fd, &db->st, &db->map) < 0)
+        return -1;
+
+    indexmdb(filename, &db->map, &db->index);
+    watchmdblive(db);
+    return 0;
+}
+
+int watchmdblive(struct MdbLive *db)
+{
+    // A watch inherited across fork() shares its event queue with the
+    // parent, so whoever reads an event first would steal it.
+    if (db->watch_fd >= 0)
+        close(db->watch_fd);
+    db->watch_fd = -1;
+
+    // Records may have been added since whoever refreshed our copy of
+    // the database last looked, before the new watch could hear of it.
+    db->dirty = 1;
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    // Watch the directory rather than the file, so that we also hear
+    // about a new file being renamed over the old one.
+    char *path = strdup(db->filename);
+    if (path == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE
+        | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM;
+    int wd = inotify_add_watch(fd, dirname(path), mask);
+    free(path);
+
+    if (wd < 0) {
+        close(fd);
+        return -1;
+    }
+
+    db->watch_fd = fd;
+    return 0;
+}
+
+// Returns whether the watch has seen any events since the last call,
+// or 1 if there is no watch and we have to check for ourselves.
+static int drainWatch(struct MdbLive *db)
+{
+    if (db->watch_fd < 0)
+        return 1;
+
+    // The events themselves don't matter; stat() tells us what changed.
+    _Alignas(struct inotify_event) char buf[4096];
+    int seen = 0;
+    ssize_t n;
+
+    while ((n = read(db->watch_fd, buf, sizeof(buf))) > 0)
+        seen = 1;
+
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        // Something is wrong with the watch; fall back to polling.
+        close(db->watch_fd);
+        db->watch_fd = -1;
+        return 1;
+    }
+    return seen;
+}
+
+// Map the database file again if it has grown or been replaced.
+// Returns 1 if it was, 0 if the records are the same, and -1 with errno
+// set if the file can't be read.
+static int remapLive(struct MdbLive *db)
+{
+    struct stat st;
+    if (stat(db->filename, &st) < 0)
+        return -1;
+
+    int same_file = st.st_dev == db->st.st_dev && st.st_ino == db->st.st_ino;
+    size_t count = (size_t)st.st_size / sizeof(struct MdbRec);
+
+    // Records are only ever appended, and the mapping is shared with
+    // the file, so only a change in the number of records matters.
+    if (same_file && count == db->map.count)
+        return 0;
+
+    int fd = open(db->filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    // The file may have changed again since stat(); go by what we map.
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    same_file = st.st_dev == db->st.st_dev && st.st_ino == db->st.st_ino;
+
+    struct MdbMap map;
+    if (mapFd(fd, &st, &map) < 0)
+        return -1;
+
+    // An index of a replaced or truncated file describes records that
+    // are gone.  Lookups scan every record until a new index is ready,
+    // which may well come from a sidecar we looked at before.
+    if (!same_file || map.count < db->index.count) {
+        freeTrigramIndex(&db->index);
+        memset(&db->index_st, 0, sizeof(db->index_st));
+    }
+
+    // The new mapping shares the page cache with the old one, so the
+    // only records read from the disk are the new ones.
+    unmapmdb(&db->map);
+    db->map = map;
+    db->st = st;
+    db->generation++;
+    return 1;
+}
+
+// Whether the records past the end of the index outnumber an eighth of
+// those it covers, which is when indexmdb() would rebuild it.
+static int indexBehind(const struct MdbLive *db)
+{
+    return db->map.count - db->index.count > db->index.count / 8;
+}
+
+// Swap in the index from the sidecar if the sidecar has changed since
+// we last looked, belongs to our records, and covers more of them than
+// the index we have.
+static void loadSidecar(struct MdbLive *db)
+{
+    char *sidecar = sidecarName(db->filename);
+    struct stat st;
+
+    if (sidecar == NULL || stat(sidecar, &st) < 0) {
+        free(sidecar);
+        return;
+    }
+
+    // Checking an index reads every record it covers, so don't check
+    // the same one twice.  A new sidecar is always a new file.
+    if (st.st_dev == db->index_st.st_dev && st.st_ino == db->index_st.st_ino
+        && st.st_size == db->index_st.st_size
+        && st.st_mtim.tv_sec == db->index_st.st_mtim.tv_sec
+        && st.st_mtim.tv_nsec == db->index_st.st_mtim.tv_nsec) {
+        free(sidecar);
+        return;
+    }
+    db->index_st = st;
+
+    struct TrigramIndex index;
+    initTrigramIndex(&index);
+
+    if (loadTrigramIndex(&index, sidecar) == 0
+        && checkTrigramIndex(&index, db->map.recs, db->map.count,
+            sizeof(struct MdbRec))
+        && index.count > db->index.count) {
+        freeTrigramIndex(&db->index);
+        db->index = index;
+    } else {
+        freeTrigramIndex(&index);
+    }
+    free(sidecar);
+}
+
+// Fork a child that builds a new index and writes it to the sidecar,
+// for every server process, this one included, to pick up through its
+// watch.  The builder holds a lock on the database's directory, and
+// one that can't take it leaves the work to the one that has it.
+static void startRebuild(struct MdbLive *db)
+{
+    // The builder doesn't tell us how it did; don't start another one
+    // while it may still be running.
+    time_t now = time(NULL);
+    if (now - db->rebuild_started < MDB_REBUILD_INTERVAL)
+        return;
+    db->rebuild_started = now;
+
+    // If fork() fails, we try again later.
+    if (fork() != 0)
+        return;
+
+    // Don't hold on to our parent's clients and sockets.
+    if (close_range(3, ~0U, 0) < 0) {
+        long max = sysconf(_SC_OPEN_MAX);
+        for (long fd = 3; fd < max; fd++)
+            close(fd);
+    }
+
+    // If the sidecar can't be written, building the index would be
+    // wasted; lookups go on scanning the records it doesn't cover.
+    char *path = strdup(db->filename);
+    if (path == NULL)
+        _exit(1);
+    int dir_fd = open(dirname(path), O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0 || flock(dir_fd, LOCK_EX | LOCK_NB) < 0
+        || faccessat(dir_fd, ".", W_OK, AT_EACCESS) < 0)
+        _exit(0);
+
+    // indexmdb() uses the sidecar instead if another builder has just
+    // brought it up to date.
+    struct MdbMap map;
+    struct TrigramIndex index;
+    if (mapmdb(db->filename, &map) < 0)
+        _exit(1);
+    _exit(indexmdb(db->filename, &map, &index) < 0);
+}
+
+int refreshmdblive(struct MdbLive *db)
+{
+    // Drain the watch even when we're going to stat() anyway, so that
+    // the events don't make us do it again next time.
+    if (!drainWatch(db) && !db->dirty)
+        return 0;
+
+    // Until we have looked at the file successfully, keep looking.
+    db->dirty = 1;
+    int changed = remapLive(db);
+    if (changed < 0)
+        return -1;
+    db->dirty = 0;
+
+    // Rebuilding the index takes a while, so it is left to a child.
+    // Until the child writes the sidecar, which sends our watch an
+    // event, the index stays in place and matchmdb() scans the records
+    // it doesn't cover.
+    if (indexBehind(db)) {
+        loadSidecar(db);
+        if (indexBehind(db))
+            startRebuild(db);
+    }
+
+    return changed;
+}
+
+void closemdblive(struct MdbLive *db)
+{
+    if (db->watch_fd >= 0)
+        close(db->watch_fd);
+    db->watch_fd = -1;
+    freeTrigramIndex(&db->index);
+    unmapmdb(&db->map);
+}
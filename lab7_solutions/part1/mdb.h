@@ -1,9 +1,102 @@
 #ifndef __MDB_H__
 #define __MDB_H__
 
+#include <stddef.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <mytrigram.h>
+#include <myvec.h>
+
 struct MdbRec {
     char name[16];
     char msg[24];
 };
 
+// A database file mapped read-only into memory: 'count' records at
+// 'recs', which point straight into the file's pages.  'size' is the
+// length of the mapping.
+struct MdbMap {
+    const struct MdbRec *recs;
+    size_t count;
+    size_t size;
+};
+
+// Map the database file 'filename'.  Returns 0 on success, or -1 with
+// errno set.  An empty file gives an empty map whose 'recs' is NULL.
+int mapmdb(const char *filename, struct MdbMap *map);
+void unmapmdb(struct MdbMap *map);
+
+// Get a trigram index over the names and msgs of 'db', whose file is
+// 'filename', from the sidecar file 'filename' + ".tri", rebuilding and
+// rewriting the sidecar if it is missing, invalid, built from another
+// database, or too far behind this one.  Returns -1 on failure,
+// leaving 'index' empty, which matchmdb() still accepts.
+int indexmdb(const char *filename, const struct MdbMap *db,
+    struct TrigramIndex *index);
+
+// Put the numbers (counting from 0) of the records of 'db' that contain
+// 'key' into 'matches', a record-mode vector of uint32_t, in increasing
+// order.  Returns the number of matches, or -1 if memory ran out.
+int matchmdb(const struct MdbMap *db, const struct TrigramIndex *index,
+    const char *key, struct Vec *matches);
+
+// Put into matches[k] what matchmdb() would for keys[k], for each of
+// the 'nkeys' keys.  Keys the index can narrow down are looked up one
+// by one; all the others are matched against each record in a single
+// pass with an Aho-Corasick automaton (see myaho.h), instead of one
+// pass per key.  Returns 0, or -1 if memory ran out.
+int matchmdbbatch(const struct MdbMap *db, const struct TrigramIndex *index,
+    const char *const *keys, int nkeys, struct Vec *matches);
+
+// A mapped and indexed database that follows its file as records are
+// appended to it.  'generation' goes up every time the records change.
+//
+// Changes are noticed through an inotify watch on the file's directory,
+// or, if that can't be set up, by stat()ing the file on every refresh.
+// When the file grows, it is mapped again at its new size; the index
+// is kept, and matchmdb() scans the records past its end.  A refresh
+// swaps in the new mapping and index between lookups, so each lookup
+// sees one consistent snapshot of the database.
+//
+// Once the records past the end of the index outnumber an eighth of
+// those it covers, or the file is replaced, a refresh forks a child to
+// rebuild the index in the background and write it to the sidecar.
+// Each process loads the new sidecar when its watch hears of it, so
+// the index is built once however many processes serve the database.
+// 'index_st' is the sidecar we last looked at, and 'rebuild_started'
+// when we last started a builder.
+struct MdbLive {
+    const char *filename;
+    struct MdbMap map;
+    struct TrigramIndex index;
+    struct stat st;
+    struct stat index_st;
+    time_t rebuild_started;
+    int watch_fd;
+    int dirty;
+    unsigned long generation;
+};
+
+// Map and index the database file 'filename', and start watching it.
+// Returns 0 on success, or -1 with errno set.  Not being able to index
+// or watch the database is not an error.
+int openmdblive(const char *filename, struct MdbLive *db);
+
+// Start watching the database from this process.  A child should call
+// this after fork(), since a watch inherited from its parent shares
+// events with the parent.  Changes made before the watch was set up
+// send it no events, so the next refreshmdblive() checks the file
+// regardless.  Returns -1 if refreshmdblive() will have to fall back
+// to stat().
+int watchmdblive(struct MdbLive *db);
+
+// Pick up any records appended to the database, or a new file renamed
+// into its place.  Returns 1 if the records changed, 0 if not, and -1
+// with errno set if the file can't be read, in which case the records
+// we already have stay in place and the next call looks again.
+int refreshmdblive(struct MdbLive *db);
+
+void closemdblive(struct MdbLive *db);
+
 #endif